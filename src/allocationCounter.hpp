@@ -0,0 +1,31 @@
+#pragma once
+#include "metrics.hpp"
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new/delete to feed
+// simulasi_allocations_total. The replacements are not inline, so include
+// this from exactly one translation unit per program.
+
+void *operator new(std::size_t size) {
+  metrics::alloc::record(size);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  metrics::alloc::record(size);
+  return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,301 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace util {
+
+// Fixed-size number for values that outgrow double: a double mantissa with
+// magnitude in [1, 2) and a 64-bit binary exponent, so it keeps double's
+// 53-bit precision over a practically unlimited range. Every operation is a
+// few double operations plus a renormalisation that only touches exponent
+// bits, so it stays close to plain double speed. Zero, inf and NaN keep
+// exponent 0 and carry their meaning in the mantissa.
+class BigNumber {
+public:
+  // Past this many binary orders of magnitude a value counts as inf (or 0).
+  static constexpr int64_t MAX_EXPONENT = int64_t{1} << 62;
+
+  constexpr BigNumber() = default;
+  BigNumber(double v) { *this = make(v, 0); }
+
+  static BigNumber fromParts(double mantissa, int64_t exponent) {
+    return make(mantissa, std::clamp(exponent, -SATURATED, SATURATED));
+  }
+
+  // 2^x for any x, including ones far past double's range.
+  static BigNumber exp2(double x) {
+    if (std::isnan(x))
+      return BigNumber(x);
+    if (x >= static_cast<double>(MAX_EXPONENT))
+      return BigNumber(HUGE_VAL);
+    if (x <= -static_cast<double>(MAX_EXPONENT))
+      return BigNumber();
+    double whole = std::floor(x);
+    return make(std::exp2(x - whole), static_cast<int64_t>(whole));
+  }
+  static BigNumber exp(double x) { return exp2(x * LOG2_E); }
+  static BigNumber pow10(double x) { return exp2(x * LOG2_10); }
+
+  // strtod, except that exponents past double's range still parse instead
+  // of saturating ("1e500").
+  static BigNumber parse(const char *s, char **end) {
+    double v = std::strtod(s, end);
+    if (std::isfinite(v) && (v != 0.0 || !hasExponent(s, *end)))
+      return BigNumber(v);
+    char mantissa[64];
+    const char *e = s;
+    while (e < *end && *e != 'e' && *e != 'E')
+      e++;
+    if (e == *end || static_cast<size_t>(e - s) >= sizeof(mantissa))
+      return BigNumber(v);
+    std::memcpy(mantissa, s, e - s);
+    mantissa[e - s] = '\0';
+    double m = std::strtod(mantissa, nullptr);
+    double power = std::strtod(e + 1, nullptr);
+    return BigNumber(m) * pow10(power);
+  }
+
+  double mantissa() const { return m; }
+  int64_t exponent() const { return e; }
+
+  // Saturates to +-inf or 0 outside double's range.
+  double toDouble() const {
+    if (e > 1024)
+      return m * HUGE_VAL;
+    if (e < -1100)
+      return m * 0.0;
+    return std::ldexp(m, static_cast<int>(e));
+  }
+  explicit operator double() const { return toDouble(); }
+
+  bool isZero() const { return m == 0.0; }
+  bool isNegative() const { return m < 0.0; }
+
+  // Binary logarithm as a double. Inside double's range it defers to
+  // std::log2, which keeps full precision close to 1.
+  double log2() const {
+    if (inDoubleRange())
+      return std::log2(toDouble());
+    return static_cast<double>(e) + std::log2(m);
+  }
+
+  BigNumber operator-() const {
+    BigNumber r = *this;
+    r.m = -r.m;
+    return r;
+  }
+
+  friend BigNumber operator+(BigNumber a, BigNumber b) {
+    if (b.m == 0.0)
+      return a;
+    if (a.m == 0.0)
+      return b;
+    if (!std::isfinite(a.m) || !std::isfinite(b.m))
+      return BigNumber(a.m + b.m);
+    if (a.e < b.e)
+      std::swap(a, b);
+    // a.e - b.e itself can pass int64 for exponents of opposite sign.
+    if (b.e < a.e - PRECISION_BITS)
+      return a;
+    return make(a.m + b.m * scale(a.e - b.e), a.e);
+  }
+  friend BigNumber operator-(BigNumber a, BigNumber b) { return a + -b; }
+  friend BigNumber operator*(BigNumber a, BigNumber b) {
+    int64_t e;
+    if (__builtin_add_overflow(a.e, b.e, &e))
+      e = a.e < 0 ? -SATURATED : SATURATED;
+    return make(a.m * b.m, std::clamp(e, -SATURATED, SATURATED));
+  }
+  friend BigNumber operator/(BigNumber a, BigNumber b) {
+    int64_t e;
+    if (__builtin_sub_overflow(a.e, b.e, &e))
+      e = a.e < 0 ? -SATURATED : SATURATED;
+    return make(a.m / b.m, std::clamp(e, -SATURATED, SATURATED));
+  }
+  BigNumber &operator+=(BigNumber b) { return *this = *this + b; }
+  BigNumber &operator-=(BigNumber b) { return *this = *this - b; }
+  BigNumber &operator*=(BigNumber b) { return *this = *this * b; }
+  BigNumber &operator/=(BigNumber b) { return *this = *this / b; }
+
+  friend bool operator==(BigNumber a, BigNumber b) {
+    return a.m == b.m && a.e == b.e;
+  }
+  friend std::partial_ordering operator<=>(BigNumber a, BigNumber b) {
+    // Exponents only order two finite, non-zero values of the same sign;
+    // everything else (zero, sign change, inf, NaN) is decided by the
+    // mantissas alone, as is the common case of equal exponents.
+    if (a.e == b.e)
+      return a.m <=> b.m;
+    if (a.m != 0.0 && b.m != 0.0 && (a.m < 0.0) == (b.m < 0.0) &&
+        std::isfinite(a.m) && std::isfinite(b.m))
+      return a.m < 0.0 ? b.e <=> a.e : a.e <=> b.e;
+    return a.m <=> b.m;
+  }
+
+  friend BigNumber abs(BigNumber a) {
+    a.m = std::abs(a.m);
+    return a;
+  }
+  friend bool isfinite(BigNumber a) { return std::isfinite(a.m); }
+  friend bool isnan(BigNumber a) { return std::isnan(a.m); }
+
+  friend BigNumber log2(BigNumber a) { return BigNumber(a.log2()); }
+  friend BigNumber log(BigNumber a) {
+    return a.inDoubleRange() ? std::log(a.toDouble()) : a.log2() * LN_2;
+  }
+  friend BigNumber log10(BigNumber a) {
+    return a.inDoubleRange() ? std::log10(a.toDouble()) : a.log2() * LOG10_2;
+  }
+
+  friend BigNumber pow(BigNumber a, BigNumber p) {
+    double power = p.toDouble();
+    // Small enough for std::pow to get it right directly, unless the
+    // result under- or overflows.
+    if (a.inDoubleRange()) {
+      double direct = std::pow(a.toDouble(), power);
+      if (std::isnan(direct) || std::isnormal(direct) ||
+          (direct == 0.0 && a.m == 0.0))
+        return BigNumber(direct);
+    }
+    if (a.m == 0.0 || !std::isfinite(a.m))
+      return BigNumber(std::pow(a.m, power));
+    double sign = 1.0;
+    if (a.m < 0.0) {
+      // Like std::pow: negative bases only take integer powers.
+      if (std::floor(power) != power)
+        return BigNumber(std::nan(""));
+      sign = std::fmod(power, 2.0) == 0.0 ? 1.0 : -1.0;
+    }
+    BigNumber r = exp2(power * abs(a).log2());
+    r.m *= sign;
+    return r;
+  }
+
+  friend BigNumber sqrt(BigNumber a) {
+    int64_t half = floorDiv(a.e, 2);
+    return make(std::sqrt(std::ldexp(a.m, static_cast<int>(a.e - 2 * half))),
+                half);
+  }
+  friend BigNumber cbrt(BigNumber a) {
+    int64_t third = floorDiv(a.e, 3);
+    return make(std::cbrt(std::ldexp(a.m, static_cast<int>(a.e - 3 * third))),
+                third);
+  }
+
+  // Past 2^52 every double is already an integer.
+  friend BigNumber round(BigNumber a) {
+    return a.e >= PRECISION_BITS ? a : BigNumber(std::round(a.toDouble()));
+  }
+  friend BigNumber floor(BigNumber a) {
+    return a.e >= PRECISION_BITS ? a : BigNumber(std::floor(a.toDouble()));
+  }
+
+  // a - b * trunc(a / b). Once the quotient is past double precision, the
+  // remainder is below it and comes back as 0.
+  friend BigNumber fmod(BigNumber a, BigNumber b) {
+    if (b.m == 0.0 || !std::isfinite(a.m) || !std::isfinite(b.m))
+      return BigNumber(std::fmod(a.m, b.m));
+    BigNumber q = a / b;
+    if (q.e >= PRECISION_BITS)
+      return BigNumber();
+    return a - b * BigNumber(std::trunc(q.toDouble()));
+  }
+
+  friend BigNumber sin(BigNumber a) { return std::sin(a.toDouble()); }
+  friend BigNumber cos(BigNumber a) { return std::cos(a.toDouble()); }
+
+  // printf("%.*f") while that stays short, scientific ("1.23e456") beyond
+  // 1e9 or below 1e-3. Works for exponents past double's range.
+  std::array<char, 32> format(int precision = 2) const {
+    std::array<char, 32> out{};
+    double magnitude = std::abs(toDouble());
+    if (!std::isfinite(m) || m == 0.0 ||
+        (magnitude < 1e9 && magnitude >= 1e-3)) {
+      std::snprintf(out.data(), out.size(), "%.*f", precision, toDouble());
+      return out;
+    }
+    double digits = abs(*this).log2() * LOG10_2;
+    double power = std::floor(digits);
+    double lead = std::pow(10.0, digits - power);
+    // Rounding to `precision` places can carry into another digit.
+    if (lead + 0.5 * std::pow(10.0, -precision) >= 10.0) {
+      lead /= 10.0;
+      power += 1.0;
+    }
+    std::snprintf(out.data(), out.size(), "%s%.*fe%.0f", m < 0.0 ? "-" : "",
+                  precision, lead, power);
+    return out;
+  }
+
+private:
+  static constexpr int64_t PRECISION_BITS = 53;
+  // Past MAX_EXPONENT, with room left for make() to renormalise without
+  // wrapping: exponents are clamped here before they reach it.
+  static constexpr int64_t SATURATED = MAX_EXPONENT + MAX_EXPONENT / 2;
+  static constexpr double LN_2 = 0.69314718055994530942;
+  static constexpr double LOG2_E = 1.44269504088896340736;
+  static constexpr double LOG10_2 = 0.30102999566398119521;
+  static constexpr double LOG2_10 = 3.32192809488736234787;
+  static constexpr uint64_t EXPONENT_MASK = uint64_t{0x7ff} << 52;
+  static constexpr uint64_t EXPONENT_BIAS = 1023;
+
+  // Brings the mantissa back to [1, 2) by moving its binary exponent into
+  // e, straight from the bit pattern. Zero, subnormals, inf and NaN take
+  // the slow path.
+  static BigNumber make(double mantissa, int64_t exponent) {
+    uint64_t bits = std::bit_cast<uint64_t>(mantissa);
+    uint64_t field = (bits & EXPONENT_MASK) >> 52;
+    if (field == 0 || field == 0x7ff)
+      return makeSlow(mantissa, exponent);
+    BigNumber r;
+    r.e = exponent + static_cast<int64_t>(field - EXPONENT_BIAS);
+    r.m = std::bit_cast<double>((bits & ~EXPONENT_MASK) |
+                                (EXPONENT_BIAS << 52));
+    if (r.e > MAX_EXPONENT || r.e < -MAX_EXPONENT)
+      return BigNumber(r.e > 0 ? r.m * HUGE_VAL : r.m * 0.0);
+    return r;
+  }
+
+  static BigNumber makeSlow(double mantissa, int64_t exponent) {
+    BigNumber r;
+    if (mantissa == 0.0 || !std::isfinite(mantissa)) {
+      r.m = mantissa;
+      return r;
+    }
+    int shift = 0;
+    double fraction = std::frexp(mantissa, &shift);
+    return make(fraction * 2.0, exponent + shift - 1);
+  }
+
+  // 2^-shift for 0 <= shift <= 53, built from its bit pattern.
+  static double scale(int64_t shift) {
+    return std::bit_cast<double>((EXPONENT_BIAS - shift) << 52);
+  }
+
+  bool inDoubleRange() const { return e > -1000 && e < 1000; }
+
+  static int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return q * b > a ? q - 1 : q;
+  }
+
+  static bool hasExponent(const char *begin, const char *end) {
+    for (const char *p = begin; p < end; p++)
+      if (*p == 'e' || *p == 'E')
+        return true;
+    return false;
+  }
+
+  double m = 0.0;
+  int64_t e = 0;
+};
+
+} // namespace util
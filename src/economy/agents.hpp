@@ -0,0 +1,470 @@
+#pragma once
+#include "economy/base.hpp"
+#include "gambling/slotMachine.hpp"
+#include "metrics.hpp"
+#include "persistent.hpp"
+#include "profiler.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Simulated traders acting on the economy every tick.
+//
+// Agent state is stored column by column, so each pass streams only the
+// fields it touches. Columns are copy-on-write, so copying a Population
+// shares every chunk no agent has changed since. A tick runs in two phases.
+// First, strategies are evaluated in parallel chunks and write only to their
+// own agents' columns. Then the chosen actions are applied one agent at a
+// time in index order. Random draws are hashed from (seed, tick, agent)
+// rather than taken from a shared stream, so the outcome is the same for any
+// worker count.
+namespace agents {
+
+enum class Action : uint8_t { Hold, Upgrade, Gamble, Buy, Sell };
+constexpr size_t ACTION_COUNT = 5;
+
+// Arguments a strategy formula sees, as V0..V6. The result is rounded to an
+// Action; anything out of range holds.
+enum Arg {
+  BALANCE,
+  VALUE,        // target object's value
+  LEVEL,        // target object's level
+  UPGRADE_COST, // cost of one more level of the target object
+  STOCK_PRICE,
+  SHARES,
+  RANDOM, // uniform in [0, 1), fresh per agent per tick
+  ARG_COUNT
+};
+
+struct Strategy {
+  std::string name;
+  util::LogicEvaluator<> formula;
+};
+
+inline std::vector<Strategy> defaultStrategies() {
+  return {
+      {"Upgrader", util::LogicEvaluator("?>V0,V3,1,0")},
+      {"Gambler", util::LogicEvaluator("?<V6,0.1,2,0")},
+      {"Trader", util::LogicEvaluator("?<V6,0.5,?>V0,V4,3,0,?>V5,0,4,0")},
+  };
+}
+
+template <typename T> using AgentColumn = persistent::Column<T, 12>;
+
+// Threads that outlive a tick. Spawning a thread per chunk per tick cost a
+// create and join every time, and each new thread registered its own metric
+// and profiler slots. Copies start without threads and spawn their own on
+// first use.
+class WorkerPool {
+public:
+  WorkerPool() = default;
+  WorkerPool(const WorkerPool &) {}
+  WorkerPool &operator=(const WorkerPool &) { return *this; }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : threads)
+      t.join();
+  }
+
+  // Calls job(0) on this thread and job(1) .. job(tasks - 1) on pool
+  // threads, and returns once all of them have.
+  void run(size_t tasks, const std::function<void(size_t)> &job) {
+    while (threads.size() + 1 < tasks) {
+      size_t index = threads.size() + 1;
+      threads.emplace_back(
+          [this, index, seen = generation] { work(index, seen); });
+    }
+    {
+      std::lock_guard lock(mutex);
+      current = &job;
+      active = tasks;
+      pending = tasks - 1;
+      generation++;
+    }
+    wake.notify_all();
+    job(0);
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+    current = nullptr;
+  }
+
+private:
+  void work(size_t index, uint64_t seen) {
+    for (;;) {
+      const std::function<void(size_t)> *job;
+      {
+        std::unique_lock lock(mutex);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping)
+          return;
+        seen = generation;
+        if (index >= active)
+          continue;
+        job = current;
+      }
+      (*job)(index);
+      std::lock_guard lock(mutex);
+      if (--pending == 0)
+        done.notify_one();
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  const std::function<void(size_t)> *current = nullptr;
+  size_t active = 0;
+  size_t pending = 0;
+  uint64_t generation = 0;
+  bool stopping = false;
+};
+
+class Population {
+public:
+  // Workers split the population on column chunk boundaries, so no two
+  // threads write to the same chunk.
+  static constexpr size_t CHUNK = AgentColumn<float>::CHUNK;
+  // Fraction of the balance bet per slot roll.
+  static constexpr float GAMBLE_FRACTION = 0.1f;
+  // Order prices land within this fraction of the stock's value.
+  static constexpr double QUOTE_SPREAD = 0.02;
+  static constexpr uint32_t MAX_ORDER = 5;
+
+  explicit Population(uint64_t seed = 1)
+      : strategies(defaultStrategies()), seed(seed),
+        slots(1.0f, util::rand::Xoshiro256(seed)) {}
+
+  // --- Columns ---
+  AgentColumn<float> balance;
+  // Levels bought through upgrades. Each pays its owner level * dt per tick,
+  // the same rate it adds to the object.
+  AgentColumn<float> levels;
+  AgentColumn<int64_t> shares;
+  // Raw picks; reduced modulo the object and stock counts when used.
+  AgentColumn<uint32_t> target;
+  AgentColumn<uint32_t> stock;
+  AgentColumn<uint8_t> strategy;
+  // At most one resting order per agent, with its side and limit price.
+  AgentColumn<market::OrderBook::OrderId> openOrder;
+  AgentColumn<uint8_t> openSide;
+  AgentColumn<int64_t> openPrice;
+
+  std::vector<Strategy> strategies;
+  unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+  uint64_t seed;
+  uint64_t tickCount = 0;
+  // Actions applied during the last tick, indexed by Action.
+  std::array<uint64_t, ACTION_COUNT> lastActions{};
+
+  size_t size() const { return balance.size(); }
+
+  // Heap bytes a copy duplicates; the agent columns are copy-on-write and
+  // the decision scratch isn't copied.
+  size_t heapBytes() const {
+    return strategies.capacity() * sizeof(Strategy) +
+           views.capacity() * sizeof(ObjectView) +
+           prices.capacity() * sizeof(double);
+  }
+
+  // Adds `count` agents, spread over the strategies in turn.
+  void spawn(size_t count, float startBalance = 100.0f,
+             int64_t startShares = 10) {
+    size_t first = size();
+    resize(first + count);
+    for (size_t i = first; i < first + count; i++) {
+      uint64_t r = draw(~uint64_t{0}, i, 0);
+      balance.mut(i) = startBalance;
+      shares.mut(i) = startShares;
+      target.mut(i) = static_cast<uint32_t>(r);
+      stock.mut(i) = static_cast<uint32_t>(r >> 32);
+      strategy.mut(i) = static_cast<uint8_t>(i % strategies.size());
+    }
+  }
+
+  // Pulls every resting order first so no later print credits a reused
+  // index.
+  void clear(std::vector<Stock> &stocks) {
+    for (size_t i = 0; i < size(); i++)
+      if (!stocks.empty())
+        cancelOpen(i, stocks);
+    resize(0);
+  }
+
+  void tick(std::vector<EconomyObject> &objects, std::vector<Stock> &stocks,
+            float dt) {
+    PROFILE_SCOPE("agents::tick");
+    if (size() == 0 || strategies.empty())
+      return;
+    snapshot(objects, stocks);
+    scratch.action.resize(size());
+    decideAll(dt);
+    apply(objects, stocks);
+    tickCount++;
+  }
+
+private:
+  struct ObjectView {
+    double value;
+    double level;
+    double cost;
+    bool stale;
+  };
+
+  // Per-tick scratch. decide() refills it every tick, so copies start empty
+  // rather than duplicating it.
+  struct Scratch {
+    std::vector<uint8_t> action;
+    Scratch() = default;
+    Scratch(const Scratch &) {}
+    Scratch &operator=(const Scratch &) { return *this; }
+  };
+
+  void resize(size_t n) {
+    balance.resize(n);
+    levels.resize(n, 0.0f);
+    shares.resize(n, 0);
+    target.resize(n);
+    stock.resize(n);
+    strategy.resize(n);
+    openOrder.resize(n, market::OrderBook::NO_ORDER);
+    openSide.resize(n, 0);
+    openPrice.resize(n, 0);
+  }
+
+  uint64_t draw(uint64_t tick, size_t agent, uint64_t salt) const {
+    return util::rand::mix64(
+        seed ^ util::rand::mix64(tick * 0x9E3779B97F4A7C15ull ^
+                                 util::rand::mix64(agent * 4 + salt)));
+  }
+
+  static double unit(uint64_t r) { return (r >> 11) * 0x1.0p-53; }
+
+  // Read-only copies of what strategies look at, so the parallel phase
+  // never touches the objects themselves. Agents trade in plain doubles;
+  // object figures past double range saturate to inf.
+  void snapshot(const std::vector<EconomyObject> &objects,
+                const std::vector<Stock> &stocks) {
+    views.resize(objects.size());
+    for (size_t j = 0; j < objects.size(); j++)
+      views[j] = {objects[j].value.toDouble(), objects[j].level.toDouble(),
+                  objects[j].getValueForLevelUpgrade().toDouble(), false};
+    prices.resize(stocks.size());
+    for (size_t k = 0; k < stocks.size(); k++)
+      prices[k] = stocks[k].value.toDouble();
+  }
+
+  void decideAll(float dt) {
+    PROFILE_SCOPE("agents::decide");
+    size_t chunks = balance.chunkCount();
+    size_t threads = std::min<size_t>(workers, chunks);
+    if (threads <= 1) {
+      decide(0, chunks, dt);
+      return;
+    }
+    balance.detach();
+    size_t perThread = (chunks + threads - 1) / threads;
+    pool.run(threads, [this, perThread, chunks, dt](size_t t) {
+      decide(std::min(chunks, t * perThread),
+             std::min(chunks, (t + 1) * perThread), dt);
+    });
+  }
+
+  void decide(size_t firstChunk, size_t endChunk, float dt) {
+    std::vector<double> args(ARG_COUNT, 0.0);
+    for (size_t c = firstChunk; c < endChunk; c++) {
+      size_t base = c * CHUNK;
+      size_t count = std::min(CHUNK, size() - base);
+      const float *owned = levels.chunk(c);
+      const float *cash = balance.chunk(c);
+      // Only agents holding levels earn, so most chunks stay shared with
+      // older copies.
+      if (std::any_of(owned, owned + count, [](float l) { return l != 0; })) {
+        float *earning = balance.mutableChunk(c);
+        for (size_t k = 0; k < count; k++)
+          earning[k] += owned[k] * dt;
+        cash = earning;
+      }
+      const uint32_t *targets = target.chunk(c);
+      const uint32_t *stocks = stock.chunk(c);
+      const int64_t *held = shares.chunk(c);
+      const uint8_t *plans = strategy.chunk(c);
+
+      for (size_t k = 0; k < count; k++) {
+        if (!views.empty()) {
+          const ObjectView &v = views[targets[k] % views.size()];
+          args[VALUE] = v.value;
+          args[LEVEL] = v.level;
+          args[UPGRADE_COST] = v.cost;
+        }
+        if (!prices.empty())
+          args[STOCK_PRICE] = prices[stocks[k] % prices.size()];
+        args[BALANCE] = cash[k];
+        args[SHARES] = static_cast<double>(held[k]);
+        args[RANDOM] = unit(draw(tickCount, base + k, 0));
+
+        const Strategy &plan = strategies[plans[k] % strategies.size()];
+        double choice = std::round(plan.formula.evaluate(args));
+        scratch.action[base + k] = choice >= 0.0 && choice < ACTION_COUNT
+                                       ? static_cast<uint8_t>(choice)
+                                       : static_cast<uint8_t>(Action::Hold);
+      }
+    }
+  }
+
+  void apply(std::vector<EconomyObject> &objects, std::vector<Stock> &stocks) {
+    PROFILE_SCOPE("agents::apply");
+    lastActions.fill(0);
+    for (size_t i = 0; i < size(); i++) {
+      Action a = static_cast<Action>(scratch.action[i]);
+      bool done = false;
+      switch (a) {
+      case Action::Upgrade:
+        done = upgrade(i, objects);
+        break;
+      case Action::Gamble:
+        slots.setBid(balance[i] * GAMBLE_FRACTION);
+        done = slots.roll(balance.mut(i)) >= 0;
+        break;
+      case Action::Buy:
+      case Action::Sell:
+        done = trade(i, a == Action::Buy ? market::Side::Buy
+                                         : market::Side::Sell,
+                     stocks);
+        break;
+      default:
+        break;
+      }
+      lastActions[static_cast<size_t>(done ? a : Action::Hold)]++;
+    }
+    metrics::sim::agentDecisions.inc(static_cast<double>(size()));
+  }
+
+  bool upgrade(size_t i, std::vector<EconomyObject> &objects) {
+    if (objects.empty())
+      return false;
+    size_t j = target[i] % objects.size();
+    ObjectView &v = views[j];
+    if (v.stale) {
+      v.cost = objects[j].getValueForLevelUpgrade().toDouble();
+      v.stale = false;
+    }
+    if (balance[i] < v.cost)
+      return false;
+    balance.mut(i) -= v.cost;
+    levels.mut(i) += 1.0f;
+    objects[j].level += 1.0;
+    v.stale = true;
+    return true;
+  }
+
+  // Replaces the agent's resting order with a new limit order near the
+  // stock's value. Buys escrow cash and sells escrow shares up front, so a
+  // fill never needs a balance check; whatever neither fills nor rests
+  // comes straight back. A stock priced past the book's ladder isn't
+  // traded.
+  bool trade(size_t i, market::Side side, std::vector<Stock> &stocks) {
+    if (stocks.empty())
+      return false;
+    size_t k = stock[i] % stocks.size();
+    Stock &s = stocks[k];
+    cancelOpen(i, stocks);
+
+    uint64_t r = draw(tickCount, i, 1);
+    double quote =
+        s.value.toDouble() * (1.0 + (unit(r) * 2.0 - 1.0) * QUOTE_SPREAD);
+    int64_t price = std::max<int64_t>(1, s.toTicks(quote));
+    if (price >= market::OrderBook::MAX_TICKS)
+      return false;
+    uint32_t quantity = 1 + static_cast<uint32_t>((r & 0xFF) % MAX_ORDER);
+    bool buying = side == market::Side::Buy;
+
+    if (buying) {
+      double unitCost = s.fromTicks(price);
+      quantity = std::min<uint32_t>(
+          quantity, static_cast<uint32_t>(balance[i] / unitCost));
+      if (quantity == 0)
+        return false;
+      balance.mut(i) -= static_cast<float>(unitCost * quantity);
+    } else {
+      quantity = static_cast<uint32_t>(
+          std::min<int64_t>(quantity, std::max<int64_t>(shares[i], 0)));
+      if (quantity == 0)
+        return false;
+      shares.mut(i) -= quantity;
+    }
+
+    size_t from = s.book.trades().size();
+    auto id = s.book.limit(side, price, quantity,
+                           static_cast<uint32_t>(i + 1));
+    settle(s, from, price);
+    uint32_t filled = 0;
+    for (size_t t = from; t < s.book.trades().size(); t++)
+      filled += s.book.trades()[t].quantity;
+    uint32_t unplaced = quantity - filled - s.book.remaining(id);
+    if (buying)
+      balance.mut(i) += static_cast<float>(s.fromTicks(price) * unplaced);
+    else
+      shares.mut(i) += unplaced;
+    openOrder.mut(i) = id;
+    openSide.mut(i) = static_cast<uint8_t>(side);
+    openPrice.mut(i) = price;
+    return true;
+  }
+
+  // Credits both sides of the prints from index `from` on. Owners are agent
+  // index + 1; 0 is an order placed outside the population.
+  void settle(const Stock &s, size_t from, int64_t aggressorLimit) {
+    const auto &prints = s.book.trades();
+    for (size_t t = from; t < prints.size(); t++) {
+      const market::Trade &tr = prints[t];
+      if (tr.buyOwner != 0 && tr.buyOwner <= size()) {
+        size_t b = tr.buyOwner - 1;
+        shares.mut(b) += tr.quantity;
+        // An aggressive buy escrowed at its limit but filled at the resting
+        // price; hand back the difference.
+        if (tr.aggressor == market::Side::Buy)
+          balance.mut(b) += static_cast<float>(
+              s.fromTicks(aggressorLimit - tr.price) * tr.quantity);
+      }
+      if (tr.sellOwner != 0 && tr.sellOwner <= size())
+        balance.mut(tr.sellOwner - 1) +=
+            static_cast<float>(s.fromTicks(tr.price) * tr.quantity);
+    }
+  }
+
+  void cancelOpen(size_t i, std::vector<Stock> &stocks) {
+    if (openOrder[i] == market::OrderBook::NO_ORDER)
+      return;
+    Stock &s = stocks[stock[i] % stocks.size()];
+    uint32_t left = s.book.remaining(openOrder[i]);
+    if (left > 0 && s.book.cancel(openOrder[i])) {
+      if (openSide[i] == static_cast<uint8_t>(market::Side::Buy))
+        balance.mut(i) += static_cast<float>(s.fromTicks(openPrice[i]) * left);
+      else
+        shares.mut(i) += left;
+    }
+    openOrder.mut(i) = market::OrderBook::NO_ORDER;
+  }
+
+  std::vector<ObjectView> views;
+  std::vector<double> prices;
+  Scratch scratch;
+  WorkerPool pool;
+  gambling::SlotMachine<5> slots;
+};
+
+} // namespace agents
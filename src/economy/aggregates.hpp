@@ -0,0 +1,323 @@
+#pragma once
+#include "bigNumber.hpp"
+#include "economy/base.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace market {
+
+// Log-bucketed histogram in the style of DDSketch: bucket k holds values in
+// (gamma^(k-1), gamma^k], so any quantile comes back within `accuracy`
+// relative error. Adding or removing a value is O(1), which lets the sketch
+// follow values that change rather than only grow. Each sign keeps at most
+// MAX_BUCKETS buckets; past that the smallest magnitudes share one bucket.
+class QuantileSketch {
+public:
+  using Number = util::BigNumber;
+
+  explicit QuantileSketch(double accuracy = 0.01)
+      : gamma((1.0 + accuracy) / (1.0 - accuracy)),
+        log2Gamma(std::log2(gamma)) {}
+
+  void add(Number v) { adjust(v, 1); }
+  void remove(Number v) { adjust(v, -1); }
+  int64_t count() const { return total; }
+  size_t heapBytes() const {
+    return (positive.counts.capacity() + negative.counts.capacity()) *
+           sizeof(int64_t);
+  }
+
+  // q in [0, 1]; 0 when empty.
+  Number quantile(double q) const {
+    if (total <= 0)
+      return Number();
+    int64_t rank = static_cast<int64_t>(
+        std::clamp(q, 0.0, 1.0) * static_cast<double>(total - 1));
+    // Negative values, most negative (largest key) first.
+    for (size_t i = negative.counts.size(); i-- > 0;) {
+      rank -= negative.counts[i];
+      if (rank < 0)
+        return -valueOf(negative.offset + static_cast<int64_t>(i));
+    }
+    rank -= zeros;
+    if (rank < 0)
+      return Number();
+    for (size_t i = 0; i < positive.counts.size(); i++) {
+      rank -= positive.counts[i];
+      if (rank < 0)
+        return valueOf(positive.offset + static_cast<int64_t>(i));
+    }
+    return valueOf(positive.offset +
+                   static_cast<int64_t>(positive.counts.size()) - 1);
+  }
+
+private:
+  // Magnitudes below this count as zero.
+  static constexpr double MIN_VALUE = 1e-9;
+  static constexpr int64_t MAX_BUCKETS = 4096;
+
+  struct Store {
+    std::vector<int64_t> counts;
+    int64_t offset = 0;
+
+    void bump(int64_t key, int64_t delta) {
+      int64_t size = static_cast<int64_t>(counts.size());
+      if (counts.empty()) {
+        offset = key;
+        counts.push_back(0);
+      } else if (key < offset) {
+        // Extend downwards while there is room, else fold into the lowest
+        // bucket.
+        int64_t grow = std::min(offset - key, MAX_BUCKETS - size);
+        counts.insert(counts.begin(), static_cast<size_t>(grow), 0);
+        offset -= grow;
+      } else if (key - offset >= size) {
+        counts.resize(static_cast<size_t>(key - offset) + 1, 0);
+        int64_t excess = static_cast<int64_t>(counts.size()) - MAX_BUCKETS;
+        if (excess > 0) {
+          int64_t folded = 0;
+          for (int64_t i = 0; i <= excess; i++)
+            folded += counts[i];
+          counts.erase(counts.begin(), counts.begin() + excess);
+          counts[0] = folded;
+          offset += excess;
+        }
+      }
+      counts[static_cast<size_t>(std::max(key, offset) - offset)] += delta;
+    }
+  };
+
+  void adjust(Number v, int64_t delta) {
+    if (!isfinite(v))
+      return;
+    if (v > Number(MIN_VALUE))
+      positive.bump(key(v), delta);
+    else if (v < Number(-MIN_VALUE))
+      negative.bump(key(-v), delta);
+    else
+      zeros += delta;
+    total += delta;
+  }
+
+  int64_t key(Number v) const {
+    return static_cast<int64_t>(std::ceil(v.log2() / log2Gamma));
+  }
+  // Midpoint (in relative terms) of bucket k.
+  Number valueOf(int64_t k) const {
+    return Number::exp2(static_cast<double>(k) * log2Gamma) *
+           Number(2.0 / (gamma + 1.0));
+  }
+
+  double gamma;
+  double log2Gamma;
+  Store positive;
+  Store negative;
+  int64_t zeros = 0;
+  int64_t total = 0;
+};
+
+// Binary max-heap over item ids keyed by a score that can move either way.
+// pos[] tracks where each id sits, so changing a score is one sift, O(log
+// n). top(k) walks the heap from the root with a k-sized frontier instead
+// of popping, in O(k log k).
+class IndexedHeap {
+public:
+  void resize(size_t n) {
+    heap.resize(n);
+    pos.resize(n);
+    score.assign(n, 0.0);
+    for (size_t i = 0; i < n; i++)
+      heap[i] = pos[i] = static_cast<uint32_t>(i);
+  }
+
+  size_t size() const { return heap.size(); }
+
+  void set(uint32_t id, double s) {
+    double old = score[id];
+    score[id] = s;
+    if (s > old)
+      siftUp(pos[id]);
+    else if (s < old)
+      siftDown(pos[id]);
+  }
+
+  double get(uint32_t id) const { return score[id]; }
+  size_t heapBytes() const {
+    return (heap.capacity() + pos.capacity()) * sizeof(uint32_t) +
+           score.capacity() * sizeof(double);
+  }
+
+  std::vector<uint32_t> top(size_t k) const {
+    std::vector<uint32_t> out;
+    if (heap.empty())
+      return out;
+    auto lower = [this](uint32_t a, uint32_t b) {
+      return score[heap[a]] < score[heap[b]];
+    };
+    std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(lower)>
+        frontier(lower);
+    frontier.push(0);
+    while (!frontier.empty() && out.size() < k) {
+      uint32_t at = frontier.top();
+      frontier.pop();
+      out.push_back(heap[at]);
+      for (uint32_t child = 2 * at + 1; child <= 2 * at + 2; child++)
+        if (child < heap.size())
+          frontier.push(child);
+    }
+    return out;
+  }
+
+private:
+  void swapAt(uint32_t a, uint32_t b) {
+    std::swap(heap[a], heap[b]);
+    pos[heap[a]] = a;
+    pos[heap[b]] = b;
+  }
+
+  void siftUp(uint32_t at) {
+    while (at > 0) {
+      uint32_t parent = (at - 1) / 2;
+      if (score[heap[parent]] >= score[heap[at]])
+        break;
+      swapAt(at, parent);
+      at = parent;
+    }
+  }
+
+  void siftDown(uint32_t at) {
+    size_t n = heap.size();
+    while (true) {
+      uint32_t best = at;
+      for (uint32_t child = 2 * at + 1; child <= 2 * at + 2; child++)
+        if (child < n && score[heap[child]] > score[heap[best]])
+          best = child;
+      if (best == at)
+        break;
+      swapAt(at, best);
+      at = best;
+    }
+  }
+
+  std::vector<uint32_t> heap;
+  std::vector<uint32_t> pos;
+  std::vector<double> score;
+};
+
+// Market-wide figures over economySystem, kept current from per-object
+// changes instead of rescanning every object and its history each frame:
+// total value and a divisor-based index (running sum, re-added from scratch
+// when rounding has eaten into it; see record()), the biggest movers
+// over the history window (indexed heap) and value percentiles (sketch).
+// Each record() is O(log n).
+class Aggregates {
+public:
+  using Number = util::BigNumber;
+  static constexpr double BASE_INDEX = 100.0;
+
+  struct Mover {
+    size_t object;
+    double change; // relative, over the object's history window
+  };
+
+  size_t size() const { return values.size(); }
+
+  // Starts over from the objects as they are. The index divisor is rescaled
+  // so adding or removing objects doesn't make the index jump.
+  void rebuild(const std::vector<EconomyObject> &objects) {
+    Number previousIndex = values.empty() ? Number(BASE_INDEX) : index();
+    values.assign(objects.size(), Number());
+    sketch = QuantileSketch();
+    movers.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+      values[i] = objects[i].value;
+      sketch.add(values[i]);
+      movers.set(static_cast<uint32_t>(i), std::abs(change(objects[i])));
+    }
+    resum();
+    divisor = sum > Number() ? sum / previousIndex : Number(1.0);
+  }
+
+  // Folds in object i's current state. The running sum only stays exact
+  // while no term dwarfs it: once a value far bigger than the new total
+  // leaves (a spend or a lost gamble at 1e300), what remains is rounding
+  // error at the old value's scale. Then the next read adds the values up
+  // again; so does every values.size()-th change, against slow drift.
+  void record(size_t i, const EconomyObject &e) {
+    Number v = e.value;
+    if (v != values[i]) {
+      Number old = values[i];
+      sum += v - old;
+      sketch.remove(old);
+      sketch.add(v);
+      values[i] = v;
+      if (abs(old) > abs(sum) * Number(CANCELLATION))
+        stale = true;
+      if (++changes >= values.size())
+        resum();
+    }
+    movers.set(static_cast<uint32_t>(i), std::abs(change(e)));
+  }
+
+  Number total() const {
+    if (stale)
+      resum();
+    return sum;
+  }
+  Number index() const { return total() / divisor; }
+  Number percentile(double q) const { return sketch.quantile(q); }
+
+  std::vector<Mover> topMovers(const std::vector<EconomyObject> &objects,
+                               size_t k) const {
+    std::vector<Mover> out;
+    for (uint32_t id : movers.top(k))
+      if (id < objects.size())
+        out.push_back({id, change(objects[id])});
+    return out;
+  }
+
+  // Relative change from the oldest sample in the history to the value now.
+  // Heap bytes a copy duplicates.
+  size_t heapBytes() const {
+    return values.capacity() * sizeof(Number) + sketch.heapBytes() +
+           movers.heapBytes();
+  }
+
+  static double change(const EconomyObject &e) {
+    if (e.history.empty())
+      return 0.0;
+    Number from = e.history[0];
+    if (from.isZero() || !isfinite(from))
+      return 0.0;
+    double c = ((e.value - from) / abs(from)).toDouble();
+    return std::isfinite(c) ? c : 0.0;
+  }
+
+private:
+  // A removed term this many times the remaining sum leaves its last ~20
+  // bits as rounding error.
+  static constexpr double CANCELLATION = 1 << 20;
+
+  void resum() const {
+    sum = Number();
+    for (const Number &v : values)
+      sum += v;
+    stale = false;
+    changes = 0;
+  }
+
+  std::vector<Number> values;
+  mutable Number sum;
+  mutable bool stale = false;
+  mutable size_t changes = 0;
+  Number divisor = Number(1.0);
+  QuantileSketch sketch;
+  IndexedHeap movers;
+};
+
+} // namespace market
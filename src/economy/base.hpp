@@ -1,6 +1,11 @@
 #pragma once
+#include "bigNumber.hpp"
+#include "economy/orderBook.hpp"
+#include "persistent.hpp"
 #include "utils.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <vector>
 
 class IEconomyObject {
@@ -10,28 +15,35 @@ public:
   std::string uuid;
 };
 
+// Values and levels are BigNumbers: incremental-game growth leaves float
+// (and double) range behind long before anyone stops playing.
 class EconomyObject : public IEconomyObject {
 public:
+  using Number = util::BigNumber;
+
   // Replaced template constants with constructor parameters
   EconomyObject(double defaultValue = 0.0f, int historyLength = 64,
                 double baseLevel = 1.0f, const char *upgradeLevelData = nullptr,
                 const char *valueIncreaseData = nullptr,
                 const char *name = nullptr)
       : value(defaultValue), level(baseLevel),
-        history(historyLength, defaultValue), minValue(defaultValue),
+        history(historyLength, defaultValue), historySamples(historyLength),
+        minValue(defaultValue),
         maxValue(defaultValue) // Initialize vector size
   {
     if (upgradeLevelData != nullptr) {
-      upgradeLevelFormula = util::LogicEvaluator(upgradeLevelData);
+      upgradeLevelFormula.updateFormula(upgradeLevelData);
     } else {
-      upgradeLevelFormula = util::LogicEvaluator("*10,^1.15,V0");
+      upgradeLevelFormula.updateFormula("*10,^1.15,V0");
     }
 
     if (valueIncreaseData != nullptr) {
-      rateIncreaseFormula = util::LogicEvaluator(valueIncreaseData);
+      rateIncreaseFormula.updateFormula(valueIncreaseData);
     } else {
-      rateIncreaseFormula = util::LogicEvaluator("+V0,V1");
+      rateIncreaseFormula.updateFormula("+V0,V1");
     }
+    upgradeLevelFormula.observeHistory(history);
+    rateIncreaseFormula.observeHistory(history);
     uuid = util::uuid::generate_uuid_v4();
     if (name == nullptr) {
       this->name = uuid;
@@ -41,35 +53,117 @@ public:
   }
 
   void update(float dt) override {
-    value = rateIncreaseFormula.evaluate({value, level * dt});
+    value = rateIncreaseFormula.evaluate({value, level * Number(dt)});
+    recordSample();
+  };
 
-    // Using vector-based utility or manual shift
-    util::pushToBackOfVector(history, value);
+  // Appends the current value to the history and everything derived from it.
+  void recordSample() {
+    history.push(value);
+    historySamples++;
+    upgradeLevelFormula.observe(value);
+    rateIncreaseFormula.observe(value);
 
-    minValue = *std::min_element(history.begin(), history.end());
-    maxValue = *std::max_element(history.begin(), history.end());
-  };
+    updateRange();
+  }
 
-  float getValueForLevelUpgrade(float LVup = 1.0f) {
+  // Refills the history with saved samples, oldest first, as though they
+  // had been recorded (windowed formula operators see them too). For
+  // objects rebuilt from a save or moved between processes; `total` is the
+  // sample count to carry on from.
+  void restoreHistory(const std::vector<Number> &samples, uint64_t total) {
+    for (const Number &s : samples) {
+      history.push(s);
+      upgradeLevelFormula.observe(s);
+      rateIncreaseFormula.observe(s);
+    }
+    historySamples = total;
+    updateRange();
+  }
+
+  Number getValueForLevelUpgrade(Number LVup = 1.0) const {
     return upgradeLevelFormula.evaluate({level + LVup});
   }
 
+  // Spends the upgrade cost and raises the level; false if unaffordable.
+  bool upgradeLevel(Number LVup = 1.0) {
+    Number cost = getValueForLevelUpgrade(LVup);
+    if (value < cost)
+      return false;
+    value -= cost;
+    level += LVup;
+    return true;
+  }
+
   int getHistoryLength() const { return static_cast<int>(history.size()); }
 
-  float value;
-  float level;
+  // Heap bytes a copy duplicates. The history is copy-on-write and counted
+  // by persistent::liveBytes() instead.
+  size_t heapBytes() const {
+    return uuid.capacity() + name.capacity() +
+           upgradeLevelFormula.heapBytes() + rateIncreaseFormula.heapBytes();
+  }
+
+  Number value;
+  Number level;
 
-  std::vector<float> history;
-  float minValue;
-  float maxValue;
-  util::LogicEvaluator upgradeLevelFormula;
-  util::LogicEvaluator rateIncreaseFormula;
+  // Copy-on-write ring, so copying an object (e.g. for a snapshot) shares
+  // the samples instead of duplicating them.
+  persistent::Ring<Number> history;
+  // Total samples ever pushed (the initial fill counts as historyLength).
+  uint64_t historySamples;
+  Number minValue;
+  Number maxValue;
+  util::LogicEvaluator<Number> upgradeLevelFormula;
+  util::LogicEvaluator<Number> rateIncreaseFormula;
   std::string name;
+
+private:
+  void updateRange() {
+    minValue = maxValue = value;
+    history.forEachChunk([this](const Number *samples, size_t count) {
+      auto [lo, hi] = std::minmax_element(samples, samples + count);
+      minValue = std::min(minValue, *lo);
+      maxValue = std::max(maxValue, *hi);
+    });
+  }
 };
 
-// Stock is now just a simple derived class or a specific configuration
+// A Stock is priced by its order book: when trades printed since the last
+// tick, the last trade price becomes the value. Without trades it drifts by
+// its formula like any other EconomyObject.
 class Stock : public EconomyObject {
 public:
-  Stock(float defaultValue = 0.0f, int historyLength = 64)
-      : EconomyObject(defaultValue, historyLength) {}
+  Stock(float defaultValue = 0.0f, int historyLength = 64,
+        double tickSize = 0.01)
+      : EconomyObject(defaultValue, historyLength), tickSize(tickSize) {}
+
+  void update(float dt) override {
+    const auto &trades = book.trades();
+    if (trades.empty()) {
+      EconomyObject::update(dt);
+      return;
+    }
+    value = fromTicks(trades.back().price);
+    book.clearTrades();
+    recordSample();
+  }
+
+  // Prices past the order book's ladder (or NaN) come back as MAX_TICKS
+  // and negative ones as -1, both of which the book rejects, rather than
+  // overflowing llround.
+  int64_t toTicks(double price) const {
+    double ticks = price / tickSize;
+    if (!(ticks < static_cast<double>(market::OrderBook::MAX_TICKS)))
+      return market::OrderBook::MAX_TICKS;
+    return static_cast<int64_t>(std::llround(std::max(ticks, -1.0)));
+  }
+  double fromTicks(int64_t ticks) const { return ticks * tickSize; }
+
+  size_t heapBytes() const {
+    return EconomyObject::heapBytes() + book.heapBytes();
+  }
+
+  market::OrderBook book;
+  double tickSize;
 };
@@ -0,0 +1,220 @@
+#pragma once
+#include "bigNumber.hpp"
+#include "economy/base.hpp"
+#include "persistent.hpp"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Little binary encoding for moving economy state out of the process (to a
+// shard worker, to disk). Native byte order: producer and consumer are the
+// same build on the same machine.
+namespace codec {
+
+class Writer {
+public:
+  void u8(uint8_t v) { bytes.push_back(v); }
+  void u32(uint32_t v) { raw(&v, sizeof(v)); }
+  void u64(uint64_t v) { raw(&v, sizeof(v)); }
+  void i64(int64_t v) { raw(&v, sizeof(v)); }
+  void f64(double v) { raw(&v, sizeof(v)); }
+  void number(util::BigNumber v) {
+    f64(v.mantissa());
+    i64(v.exponent());
+  }
+  void string(const std::string &s) {
+    u32(static_cast<uint32_t>(s.size()));
+    raw(s.data(), s.size());
+  }
+  void raw(const void *data, size_t size) {
+    size_t at = bytes.size();
+    bytes.resize(at + size);
+    std::memcpy(bytes.data() + at, data, size);
+  }
+
+  std::vector<uint8_t> bytes;
+};
+
+// Reads back what a Writer wrote; running off the end throws.
+class Reader {
+public:
+  Reader(const uint8_t *data, size_t size) : at(data), end(data + size) {}
+  explicit Reader(const std::vector<uint8_t> &bytes)
+      : Reader(bytes.data(), bytes.size()) {}
+
+  uint8_t u8() { return get<uint8_t>(); }
+  uint32_t u32() { return get<uint32_t>(); }
+  uint64_t u64() { return get<uint64_t>(); }
+  int64_t i64() { return get<int64_t>(); }
+  double f64() { return get<double>(); }
+  util::BigNumber number() {
+    double m = f64();
+    return util::BigNumber::fromParts(m, i64());
+  }
+  std::string string() {
+    uint32_t size = u32();
+    need(size);
+    std::string s(reinterpret_cast<const char *>(at), size);
+    at += size;
+    return s;
+  }
+
+  bool done() const { return at == end; }
+  size_t remaining() const { return static_cast<size_t>(end - at); }
+
+private:
+  template <typename T> T get() {
+    need(sizeof(T));
+    T v;
+    std::memcpy(&v, at, sizeof(T));
+    at += sizeof(T);
+    return v;
+  }
+  void need(size_t size) const {
+    if (remaining() < size)
+      throw std::runtime_error("codec: truncated record");
+  }
+
+  const uint8_t *at;
+  const uint8_t *end;
+};
+
+using Windows = functionlang::WindowSet<EconomyObject::Number>;
+
+// Field-by-field (de)serializers for HistoryWindow::transfer.
+struct WindowSaver {
+  Writer &w;
+  template <typename T> void operator()(const T &v) {
+    if constexpr (std::is_same_v<T, EconomyObject::Number>)
+      w.number(v);
+    else if constexpr (std::is_same_v<T, bool>)
+      w.u8(v);
+    else if constexpr (std::is_integral_v<T>)
+      w.u64(v);
+    else {
+      w.u64(v.size());
+      for (const auto &x : v)
+        (*this)(x);
+    }
+  }
+};
+
+struct WindowLoader {
+  Reader &r;
+  template <typename T> void operator()(T &v) {
+    if constexpr (std::is_same_v<T, EconomyObject::Number>)
+      v = r.number();
+    else if constexpr (std::is_same_v<T, bool>)
+      v = r.u8() != 0;
+    else if constexpr (std::is_integral_v<T>)
+      v = static_cast<T>(r.u64());
+    else {
+      // Sized by the formula's window length; the stored one must match.
+      if (r.u64() != v.size())
+        throw std::runtime_error("codec: window length mismatch");
+      for (auto &x : v)
+        (*this)(x);
+    }
+  }
+};
+
+inline void writeWindows(Writer &w, const Windows &windows) {
+  w.u32(static_cast<uint32_t>(windows.size()));
+  for (size_t i = 0; i < windows.size(); i++) {
+    w.u64(windows[i].getLength());
+    windows[i].transfer(WindowSaver{w});
+  }
+}
+
+// Overwrites the windows a freshly parsed formula set up; the stored layout
+// has to be the same one.
+inline void readWindows(Reader &r, Windows &windows) {
+  if (r.u32() != windows.size())
+    throw std::runtime_error("codec: window layout mismatch");
+  for (size_t i = 0; i < windows.size(); i++) {
+    if (r.u64() != windows[i].getLength())
+      throw std::runtime_error("codec: window layout mismatch");
+    windows[i].transfer(WindowLoader{r});
+    if (!windows[i].consistent())
+      throw std::runtime_error("codec: bad window state");
+  }
+}
+
+// An EconomyObject's full state, detached from the object: identity,
+// numbers, formula sources, history and formula window state. Taking one
+// is cheap enough (the history ring is shared copy-on-write; the windows
+// are copied) and the copy can be encoded on another thread while the
+// simulation carries on.
+struct ObjectRecord {
+  std::string uuid;
+  std::string name;
+  EconomyObject::Number value;
+  EconomyObject::Number level;
+  std::string upgradeSource;
+  std::string rateSource;
+  uint64_t historySamples = 0;
+  persistent::Ring<EconomyObject::Number> history;
+  Windows upgradeWindows;
+  Windows rateWindows;
+
+  static ObjectRecord of(const EconomyObject &e) {
+    return {e.uuid,
+            e.name,
+            e.value,
+            e.level,
+            e.upgradeLevelFormula.getSource(),
+            e.rateIncreaseFormula.getSource(),
+            e.historySamples,
+            e.history,
+            e.upgradeLevelFormula.getWindows(),
+            e.rateIncreaseFormula.getWindows()};
+  }
+};
+
+inline void writeRecord(Writer &w, const ObjectRecord &o) {
+  w.string(o.uuid);
+  w.string(o.name);
+  w.number(o.value);
+  w.number(o.level);
+  w.string(o.upgradeSource);
+  w.string(o.rateSource);
+  w.u64(o.historySamples);
+  w.u32(static_cast<uint32_t>(o.history.size()));
+  for (size_t i = 0; i < o.history.size(); i++)
+    w.number(o.history[i]);
+  writeWindows(w, o.upgradeWindows);
+  writeWindows(w, o.rateWindows);
+}
+
+inline void writeObject(Writer &w, const EconomyObject &e) {
+  writeRecord(w, ObjectRecord::of(e));
+}
+
+inline EconomyObject readObject(Reader &r) {
+  std::string uuid = r.string();
+  std::string name = r.string();
+  EconomyObject::Number value = r.number();
+  EconomyObject::Number level = r.number();
+  std::string upgradeSource = r.string();
+  std::string rateSource = r.string();
+  uint64_t samples = r.u64();
+  uint32_t length = r.u32();
+  std::vector<EconomyObject::Number> history(length);
+  for (auto &s : history)
+    s = r.number();
+
+  EconomyObject e(0.0, static_cast<int>(length), 0.0, upgradeSource.c_str(),
+                  rateSource.c_str(), name.c_str());
+  e.uuid = std::move(uuid);
+  e.value = value;
+  e.level = level;
+  e.restoreHistory(history, samples);
+  readWindows(r, e.upgradeLevelFormula.getWindows());
+  readWindows(r, e.rateIncreaseFormula.getWindows());
+  return e;
+}
+
+} // namespace codec
@@ -0,0 +1,143 @@
+#pragma once
+#include "economy/aggregates.hpp"
+#include "economy/agents.hpp"
+#include "economy/base.hpp"
+#include "economy/timerWheel.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Economy {
+public:
+  std::vector<EconomyObject> economySystem;
+  // Order-book priced stocks; kept apart from economySystem so they aren't
+  // sliced into plain EconomyObjects.
+  std::vector<Stock> stocks;
+  agents::Population traders;
+  // Market-wide figures over economySystem, refreshed as each object updates.
+  market::Aggregates aggregates;
+
+  // Timed events (delayed payouts, temporary boosts, ...) on a fixed
+  // EVENT_TICK clock, fired at the start of the update that reaches them.
+  static constexpr double EVENT_TICK = 0.01;
+  using Scheduler = events::TimerWheel<Economy>;
+  Scheduler scheduler;
+  double clock = 0.0;
+
+  // Boosts whose levels haven't been taken back yet, oldest first.
+  struct Boost {
+    uint64_t id;
+    std::string uuid;
+    EconomyObject::Number levels;
+  };
+  std::vector<Boost> boosts;
+  uint64_t nextBoost = 0;
+
+  static uint64_t eventTicks(double seconds) {
+    return static_cast<uint64_t>(
+        std::max(0.0, std::ceil(seconds / EVENT_TICK)));
+  }
+
+  Scheduler::EventId schedule(double delaySeconds,
+                              Scheduler::Callback callback) {
+    return scheduler.after(eventTicks(delaySeconds), std::move(callback));
+  }
+
+  // Linear scan, for event callbacks that keep a uuid rather than an index
+  // (indices shift when objects are added or removed).
+  EconomyObject *find(const std::string &uuid) {
+    auto it = std::find_if(
+        economySystem.begin(), economySystem.end(),
+        [&](const EconomyObject &e) { return e.uuid == uuid; });
+    return it == economySystem.end() ? nullptr : &*it;
+  }
+
+  // Raises an object's level by `levels` for `seconds`, then takes them back.
+  void boostLevel(EconomyObject &e, EconomyObject::Number levels,
+                  double seconds) {
+    e.level += levels;
+    uint64_t id = nextBoost++;
+    boosts.push_back({id, e.uuid, levels});
+    schedule(seconds, [id](Economy &economy) {
+      auto it = std::find_if(economy.boosts.begin(), economy.boosts.end(),
+                             [&](const Boost &b) { return b.id == id; });
+      if (it == economy.boosts.end())
+        return;
+      if (EconomyObject *target = economy.find(it->uuid))
+        target->level -= it->levels;
+      economy.boosts.erase(it);
+    });
+  }
+
+  // The level without the boosts still running, taken back the way they
+  // will be. Saves store this one, so a boost ends with the session instead
+  // of outliving it.
+  EconomyObject::Number unboostedLevel(const EconomyObject &e) const {
+    EconomyObject::Number level = e.level;
+    for (const Boost &b : boosts)
+      if (b.uuid == e.uuid)
+        level -= b.levels;
+    return level;
+  }
+
+  // Heap bytes a copy of the economy duplicates, beyond the copy-on-write
+  // chunks persistent::liveBytes() counts.
+  size_t heapBytes() const {
+    size_t bytes = economySystem.capacity() * sizeof(EconomyObject) +
+                   stocks.capacity() * sizeof(Stock) +
+                   boosts.capacity() * sizeof(Boost) + traders.heapBytes() +
+                   aggregates.heapBytes();
+    for (const auto &e : economySystem)
+      bytes += e.heapBytes();
+    for (const auto &s : stocks)
+      bytes += s.heapBytes();
+    for (const auto &b : boosts)
+      bytes += b.uuid.capacity();
+    return bytes;
+  }
+
+  void update(double dt) {
+    PROFILE_SCOPE("Economy::update");
+    uint64_t start = profiler::now();
+    clock += dt;
+    {
+      PROFILE_SCOPE("Economy::events");
+      size_t fired = scheduler.advanceTo(
+          *this, static_cast<uint64_t>(clock / EVENT_TICK));
+      metrics::sim::eventsFired.inc(static_cast<double>(fired));
+      metrics::sim::eventsPending.set(static_cast<double>(scheduler.pending()));
+    }
+    traders.tick(economySystem, stocks, static_cast<float>(dt));
+    if (aggregates.size() != economySystem.size())
+      aggregates.rebuild(economySystem);
+    {
+      PROFILE_SCOPE("Economy::objects");
+      for (size_t i = 0; i < economySystem.size(); i++) {
+        economySystem[i].update(dt);
+        aggregates.record(i, economySystem[i]);
+      }
+    }
+    for (auto &s : stocks) {
+      s.update(dt);
+    }
+    metrics::sim::ticks.inc();
+    metrics::sim::objectsUpdated.inc(
+        static_cast<double>(economySystem.size() + stocks.size()));
+    metrics::sim::tickSeconds.observe((profiler::now() - start) / 1e9);
+    if (dt > 0.0)
+      metrics::sim::tickRate.set(1.0 / dt);
+  }
+
+  Economy() {
+    economySystem.push_back(
+        EconomyObject(1.0, 1024, 1.0, nullptr, nullptr, "Base Stock"));
+    economySystem.push_back(
+        EconomyObject(0.0, 1024, 0.0, "*10,^2,V1", nullptr, "Advanced Stock"));
+    stocks.emplace_back(10.0f, 1024);
+    stocks.back().name = "Trader Stock";
+  }
+};
@@ -0,0 +1,741 @@
+#pragma once
+#include "economy/base.hpp"
+#include "economy/codec.hpp"
+#include "economy/economy.hpp"
+#include "persistent.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+// Incremental autosave: a full checkpoint plus an append-only journal of
+// what changed since. The simulation thread does a bounded slice of work
+// per frame: it scans its share of the objects for changes, or copies its
+// share of a new checkpoint, and hands the copies to a background thread.
+// That thread encodes and writes them out, group-committing with one
+// fdatasync per batch. The journal is compacted into a fresh checkpoint
+// once it grows. On startup, recover() loads the checkpoint and replays the
+// journal up to the last intact record.
+//
+// A checkpoint copied over several frames holds each object as it was when
+// its slice was taken. Each object is logged from that state on, and events
+// on objects already copied go into the next journal as well, so replay
+// still brings every object up to date.
+//
+// Economy objects are saved. Traders, stocks and pending timed events are
+// not; levels lent out by a running boost are left out of what's saved.
+namespace journal {
+
+enum RecordKind : uint8_t {
+  STATE = 1,   // uuid, value, level, recent history, windows (see Change)
+  UPGRADE = 3, // uuid, levels, value, level
+  GAMBLE,      // uuid, die, u32 rolls, value, level
+  ADD          // codec::ObjectRecord
+};
+
+// CRC-32 (IEEE), eight bytes per step ("slicing-by-8"): STATE records
+// carry history samples, so a scan's records run to a few MB.
+inline uint32_t crc32(const uint8_t *data, size_t size) {
+  using Tables = std::array<std::array<uint32_t, 256>, 8>;
+  static const Tables tables = [] {
+    Tables t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+      for (size_t k = 1; k < 8; k++)
+        t[k][i] = t[0][t[k - 1][i] & 0xFF] ^ (t[k - 1][i] >> 8);
+    return t;
+  }();
+  uint32_t c = 0xFFFFFFFFu;
+  for (; size >= 8; data += 8, size -= 8) {
+    uint32_t lo, hi;
+    std::memcpy(&lo, data, 4);
+    std::memcpy(&hi, data + 4, 4);
+    lo ^= c; // as on little-endian hosts; the reader uses the same code
+    c = tables[7][lo & 0xFF] ^ tables[6][(lo >> 8) & 0xFF] ^
+        tables[5][(lo >> 16) & 0xFF] ^ tables[4][lo >> 24] ^
+        tables[3][hi & 0xFF] ^ tables[2][(hi >> 8) & 0xFF] ^
+        tables[1][(hi >> 16) & 0xFF] ^ tables[0][hi >> 24];
+  }
+  for (; size > 0; data++, size--)
+    c = tables[0][(c ^ *data) & 0xFF] ^ (c >> 8);
+  return c ^ 0xFFFFFFFFu;
+}
+
+// Every file starts with a magic and the generation it belongs to. A
+// journal only applies on top of the checkpoint of the same generation;
+// compaction writes generation n + 1 of both.
+constexpr uint64_t CHECKPOINT_MAGIC = 0x3254504B434D4953ull; // "SIMCKPT2"
+constexpr uint64_t JOURNAL_MAGIC = 0x324C4E524A4D4953ull;    // "SIMJRNL2"
+
+struct Stats {
+  uint64_t records = 0;     // appended by the simulation thread
+  uint64_t commits = 0;     // fdatasync'd batches
+  uint64_t checkpoints = 0; // compactions written
+  uint64_t journalBytes = 0;
+  double lastCommitSeconds = 0.0; // write + fdatasync of the last batch
+};
+
+class Autosave {
+public:
+  // Seconds between two looks at the same object for changes. Every frame
+  // scans its share of the objects.
+  double interval = 5.0;
+  // Journal size that triggers compaction into a new checkpoint.
+  uint64_t compactBytes = uint64_t{16} << 20;
+  // Seconds over which a checkpoint's objects are copied, a share per frame.
+  double captureSeconds = 0.5;
+  // Longest a record waits in memory before the I/O thread commits it.
+  std::chrono::milliseconds commitDelay{200};
+
+  explicit Autosave(std::filesystem::path directory)
+      : directory(std::move(directory)) {
+    std::filesystem::create_directories(this->directory);
+  }
+
+  ~Autosave() {
+    if (!worker.joinable())
+      return;
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    if (journalFd >= 0)
+      ::close(journalFd);
+  }
+
+  Autosave(const Autosave &) = delete;
+  Autosave &operator=(const Autosave &) = delete;
+
+  // Replaces the economy's objects with the saved ones: the checkpoint,
+  // then every intact journal record after it. A torn record at the end
+  // (a crash mid-write) is cut off. Returns false when there was no save;
+  // throws std::runtime_error when there is one but it can't be read (the
+  // economy is left half-loaded then). Call before the first update().
+  bool recover(Economy &economy) {
+    std::vector<uint8_t> checkpoint = readFile(checkpointPath());
+    if (checkpoint.empty())
+      return false;
+    codec::Reader r(checkpoint);
+    if (r.u64() != CHECKPOINT_MAGIC)
+      throw std::runtime_error("journal: not a checkpoint file");
+    generation = r.u64();
+    economy.clock = r.f64();
+    economy.economySystem.clear();
+    uint64_t count = r.u64();
+    for (uint64_t i = 0; i < count; i++)
+      economy.economySystem.push_back(codec::readObject(r));
+
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < economy.economySystem.size(); i++)
+      index[economy.economySystem[i].uuid] = i;
+
+    std::vector<uint8_t> log = readFile(journalPath());
+    size_t valid = 0;
+    if (log.size() >= 16) {
+      codec::Reader header(log.data(), 16);
+      if (header.u64() == JOURNAL_MAGIC && header.u64() == generation) {
+        valid = 16;
+        while (log.size() - valid >= 8) {
+          codec::Reader frame(log.data() + valid, 8);
+          uint32_t size = frame.u32();
+          uint32_t sum = frame.u32();
+          const uint8_t *payload = log.data() + valid + 8;
+          if (log.size() - valid - 8 < size || crc32(payload, size) != sum)
+            break;
+          codec::Reader record(payload, size);
+          apply(record, economy, index);
+          valid += 8 + size;
+        }
+      }
+    }
+    if (valid > 0 && valid < log.size())
+      std::filesystem::resize_file(journalPath(), valid);
+    journalSize = valid;
+    resumeJournal = valid > 0;
+    economy.aggregates.rebuild(economy.economySystem);
+    track(economy);
+    return true;
+  }
+
+  // Call every frame from the simulation thread. Journals the objects in
+  // this frame's share whose value or level changed since they were last
+  // logged. A structural change (objects replaced or removed) or an
+  // oversized journal starts a checkpoint instead; its share of the objects
+  // is copied every frame until it can go to the I/O thread.
+  void update(const Economy &economy, double dt) {
+    if (!worker.joinable())
+      start();
+    if (!capture && (needsCheckpoint || journalSize >= compactBytes))
+      beginCapture();
+    if (capture) {
+      captureSlice(economy, share(economy.economySystem.size(), dt,
+                                  captureSeconds));
+      return;
+    }
+    if (!scan(economy, share(logged.size(), dt, interval)))
+      needsCheckpoint = true;
+  }
+
+  // Event records, journaled immediately with the object's new state. The
+  // next scan logs the object again; replay just applies both.
+  void upgraded(const Economy &economy, const EconomyObject &e,
+                EconomyObject::Number levels) {
+    codec::Writer w;
+    w.u8(UPGRADE);
+    w.string(e.uuid);
+    w.number(levels);
+    w.number(e.value);
+    w.number(economy.unboostedLevel(e));
+    append(w);
+    hold(economy, e, w);
+  }
+  void gambled(const Economy &economy, const EconomyObject &e,
+               const char *die, int rolls) {
+    codec::Writer w;
+    w.u8(GAMBLE);
+    w.string(e.uuid);
+    w.string(die);
+    w.u32(static_cast<uint32_t>(rolls));
+    w.number(e.value);
+    w.number(economy.unboostedLevel(e));
+    append(w);
+    hold(economy, e, w);
+  }
+
+  // Journals every change now, finishing a checkpoint in one go, and waits
+  // until it is on disk. For shutdown and tests; the frame loop never needs
+  // it.
+  void sync(const Economy &economy) {
+    if (!worker.joinable())
+      start();
+    if (capture || needsCheckpoint || !scan(economy, logged.size())) {
+      if (!capture)
+        beginCapture();
+      captureSlice(economy, economy.economySystem.size());
+      // Objects copied in earlier frames may have moved on since.
+      scan(economy, logged.size());
+    }
+    std::unique_lock lock(mutex);
+    uint64_t target = enqueued;
+    flushNow = true;
+    wake.notify_all();
+    durableWake.wait(lock, [&] { return durable >= target || failed; });
+  }
+
+  Stats stats() const {
+    std::lock_guard lock(mutex);
+    Stats s = ioStats;
+    s.records = appended;
+    s.journalBytes = journalSize;
+    return s;
+  }
+  // A write failed; the save stops advancing from then on.
+  bool hasFailed() const {
+    std::lock_guard lock(mutex);
+    return failed;
+  }
+
+private:
+  // What the journal last said about an object. The uuid is kept as a hash,
+  // only to notice objects being replaced.
+  struct Logged {
+    size_t uuid;
+    EconomyObject::Number value;
+    EconomyObject::Number level;
+    uint64_t samples; // historySamples
+  };
+
+  // A STATE record still to be encoded. It carries the history samples
+  // recorded since the object was last logged, so replay pushes the same
+  // samples through the history and the formula windows. When more arrived
+  // than the history holds, the windows' own state goes along.
+  struct Change {
+    std::string uuid;
+    EconomyObject::Number value;
+    EconomyObject::Number level;
+    uint64_t samples;
+    persistent::Ring<EconomyObject::Number> history;
+    uint32_t recent; // newest samples of `history` to log
+    bool withWindows;
+    codec::Windows upgradeWindows;
+    codec::Windows rateWindows;
+
+    void write(codec::Writer &w) const {
+      w.u8(STATE);
+      w.string(uuid);
+      w.number(value);
+      w.number(level);
+      w.u64(samples);
+      w.u32(recent);
+      for (size_t k = history.size() - recent; k < history.size(); k++)
+        w.number(history[k]);
+      w.u8(withWindows);
+      if (withWindows) {
+        codec::writeWindows(w, upgradeWindows);
+        codec::writeWindows(w, rateWindows);
+      }
+    }
+
+    // Framed, give or take the window state's bookkeeping.
+    uint64_t estimatedSize() const {
+      uint64_t size = 64 + uuid.size() + 16 * uint64_t{recent};
+      if (withWindows)
+        for (const codec::Windows *set : {&upgradeWindows, &rateWindows})
+          for (size_t i = 0; i < set->size(); i++)
+            size += 100 + 32 * (*set)[i].getLength();
+      return size;
+    }
+  };
+
+  // A queued unit of I/O work: journal records (a scan's changes, then
+  // frames), or a checkpoint that ends the current journal and starts the
+  // next generation's.
+  struct Batch {
+    std::vector<Change> changes;
+    std::vector<uint8_t> frames;
+    uint64_t sequence = 0; // of the last thing queued in it
+    std::shared_ptr<const std::vector<codec::ObjectRecord>> checkpoint;
+    uint64_t generation = 0;
+    double clock = 0.0;
+  };
+
+  // A checkpoint being copied: records and logged states of the objects
+  // before records.size(), and framed events on those objects, which the
+  // next journal needs again.
+  struct Capture {
+    std::vector<codec::ObjectRecord> records;
+    std::vector<Logged> logged;
+    codec::Writer held;
+    uint64_t heldRecords = 0;
+  };
+
+  std::filesystem::path checkpointPath() const {
+    return directory / "checkpoint.bin";
+  }
+  std::filesystem::path journalPath() const {
+    return directory / "journal.log";
+  }
+
+  void start() {
+    if (!resumeJournal)
+      needsCheckpoint = true;
+    worker = std::thread([this] { run(); });
+  }
+
+  // How many of `total` objects this frame handles to get through all of
+  // them in `seconds`. Fractions carry over to the next frame.
+  size_t share(size_t total, double dt, double seconds) {
+    pending += static_cast<double>(total) * dt / std::max(seconds, 1e-9);
+    size_t count =
+        static_cast<size_t>(std::min(pending, static_cast<double>(total)));
+    pending = std::min(pending - static_cast<double>(count), 1.0);
+    return count;
+  }
+
+  // Logs changed objects among the next `count`, going round, plus any new
+  // ones; false on a structural change it can't express. Changed objects
+  // are captured as detached Changes (the history ring is shared
+  // copy-on-write) and encoded by the I/O thread; new objects' frames are
+  // built here. Everything is queued together, under one lock.
+  bool scan(const Economy &economy, size_t count) {
+    const auto &objects = economy.economySystem;
+    if (objects.size() < logged.size())
+      return false;
+    std::vector<Change> changes;
+    uint64_t bytes = 0;
+    for (size_t k = 0; k < std::min(count, logged.size()); k++) {
+      if (nextScan >= logged.size())
+        nextScan = 0;
+      size_t i = nextScan++;
+      const EconomyObject &e = objects[i];
+      Logged &l = logged[i];
+      if (l.uuid != std::hash<std::string>{}(e.uuid) ||
+          l.samples > e.historySamples)
+        return false;
+      EconomyObject::Number level = economy.unboostedLevel(e);
+      if (l.value == e.value && l.level == level &&
+          l.samples == e.historySamples)
+        continue;
+      uint64_t recorded = e.historySamples - l.samples;
+      Change c{e.uuid, e.value, level, e.historySamples, e.history,
+               static_cast<uint32_t>(
+                   std::min<uint64_t>(recorded, e.history.size())),
+               false, {}, {}};
+      c.withWindows = recorded > c.recent &&
+                      (e.upgradeLevelFormula.usesHistory() ||
+                       e.rateIncreaseFormula.usesHistory());
+      if (c.withWindows) {
+        c.upgradeWindows = e.upgradeLevelFormula.getWindows();
+        c.rateWindows = e.rateIncreaseFormula.getWindows();
+      }
+      bytes += c.estimatedSize();
+      changes.push_back(std::move(c));
+      l = loggedState(economy, e);
+    }
+    size_t added = objects.size() - logged.size();
+    codec::Writer frames;
+    codec::Writer w;
+    for (size_t i = logged.size(); i < objects.size(); i++) {
+      w.bytes.clear();
+      w.u8(ADD);
+      codec::writeRecord(w, recordOf(economy, objects[i]));
+      frame(frames, w);
+      logged.push_back(loggedState(economy, objects[i]));
+    }
+    uint64_t records = changes.size() + added;
+    if (records > 0)
+      enqueue(frames, records, std::move(changes), bytes);
+    return true;
+  }
+
+  static Logged loggedState(const Economy &economy, const EconomyObject &e) {
+    return {std::hash<std::string>{}(e.uuid), e.value,
+            economy.unboostedLevel(e), e.historySamples};
+  }
+
+  static codec::ObjectRecord recordOf(const Economy &economy,
+                                      const EconomyObject &e) {
+    codec::ObjectRecord record = codec::ObjectRecord::of(e);
+    record.level = economy.unboostedLevel(e);
+    return record;
+  }
+
+  void track(const Economy &economy) {
+    logged.clear();
+    for (const auto &e : economy.economySystem)
+      logged.push_back(loggedState(economy, e));
+  }
+
+  void beginCapture() {
+    capture = std::make_unique<Capture>();
+    pending = 0.0;
+  }
+
+  // Detached copies of the next `count` objects. Once every object has
+  // one, the I/O thread gets them to encode and write, followed by the
+  // held events; scanning picks up from the copied states.
+  void captureSlice(const Economy &economy, size_t count) {
+    const auto &objects = economy.economySystem;
+    Capture &c = *capture;
+    if (objects.size() < c.records.size())
+      c = Capture(); // objects removed under it: start over
+    c.records.reserve(objects.size());
+    c.logged.reserve(objects.size());
+    size_t end = std::min(objects.size(), c.records.size() + count);
+    for (size_t i = c.records.size(); i < end; i++) {
+      c.records.push_back(recordOf(economy, objects[i]));
+      c.logged.push_back(loggedState(economy, objects[i]));
+    }
+    if (c.records.size() < objects.size())
+      return;
+    logged = std::move(c.logged);
+    auto records = std::make_shared<const std::vector<codec::ObjectRecord>>(
+        std::move(c.records));
+    needsCheckpoint = false;
+    pending = 0.0;
+    generation++;
+    {
+      std::lock_guard lock(mutex);
+      journalSize = c.held.bytes.size();
+      queue.push_back({{}, {}, ++enqueued, std::move(records), generation,
+                       economy.clock});
+      if (!c.held.bytes.empty()) {
+        queue.emplace_back();
+        queue.back().frames = std::move(c.held.bytes);
+        queue.back().sequence = ++enqueued;
+        appended += c.heldRecords;
+      }
+    }
+    wake.notify_all();
+    capture.reset();
+  }
+
+  // An event on an object whose copy the checkpoint being captured already
+  // holds: the copy predates it, so the next journal needs it too.
+  void hold(const Economy &economy, const EconomyObject &e,
+            const codec::Writer &record) {
+    if (!capture)
+      return;
+    const EconomyObject *first = economy.economySystem.data();
+    if (std::less<>{}(&e, first) ||
+        !std::less<>{}(&e, first + capture->records.size()))
+      return;
+    frame(capture->held, record);
+    capture->heldRecords++;
+  }
+
+  // [u32 size][u32 crc32][record]
+  static void frame(codec::Writer &frames, const codec::Writer &record) {
+    frames.u32(static_cast<uint32_t>(record.bytes.size()));
+    frames.u32(crc32(record.bytes.data(), record.bytes.size()));
+    frames.raw(record.bytes.data(), record.bytes.size());
+  }
+
+  void append(const codec::Writer &record) {
+    codec::Writer frames;
+    frame(frames, record);
+    enqueue(frames, 1);
+  }
+
+  // A scan's changes start a new batch, so they go out after everything
+  // queued before them and before anything appended after.
+  void enqueue(const codec::Writer &frames, uint64_t records,
+               std::vector<Change> changes = {}, uint64_t changeBytes = 0) {
+    std::lock_guard lock(mutex);
+    if (queue.empty() || queue.back().checkpoint || !changes.empty()) {
+      queue.emplace_back();
+      queue.back().changes = std::move(changes);
+    }
+    Batch &b = queue.back();
+    b.frames.insert(b.frames.end(), frames.bytes.begin(), frames.bytes.end());
+    b.sequence = ++enqueued;
+    appended += records;
+    journalSize += frames.bytes.size() + changeBytes;
+  }
+
+  static void apply(codec::Reader &r, Economy &economy,
+                    std::unordered_map<std::string, size_t> &index) {
+    uint8_t kind = r.u8();
+    if (kind == ADD) {
+      EconomyObject e = codec::readObject(r);
+      index[e.uuid] = economy.economySystem.size();
+      economy.economySystem.push_back(std::move(e));
+      return;
+    }
+    auto it = index.find(r.string());
+    if (it == index.end())
+      return;
+    EconomyObject &e = economy.economySystem[it->second];
+    switch (kind) {
+    case STATE: {
+      e.value = r.number();
+      e.level = r.number();
+      uint64_t total = r.u64();
+      std::vector<EconomyObject::Number> samples(r.u32());
+      for (auto &sample : samples)
+        sample = r.number();
+      e.restoreHistory(samples, total);
+      if (r.u8()) {
+        codec::readWindows(r, e.upgradeLevelFormula.getWindows());
+        codec::readWindows(r, e.rateIncreaseFormula.getWindows());
+      }
+      break;
+    }
+    case UPGRADE:
+      r.number();
+      e.value = r.number();
+      e.level = r.number();
+      break;
+    case GAMBLE:
+      r.string();
+      r.u32();
+      e.value = r.number();
+      e.level = r.number();
+      break;
+    }
+  }
+
+  // --- I/O thread ---
+
+  void run() {
+    if (resumeJournal) {
+      journalFd = ::open(journalPath().c_str(), O_WRONLY | O_APPEND);
+      if (journalFd < 0) {
+        std::lock_guard lock(mutex);
+        failed = true;
+      }
+    }
+    for (;;) {
+      std::deque<Batch> work;
+      bool last;
+      {
+        std::unique_lock lock(mutex);
+        wake.wait_for(lock, commitDelay,
+                      [&] { return stopping || flushNow; });
+        flushNow = false;
+        work.swap(queue);
+        last = stopping;
+      }
+      uint64_t done = 0;
+      auto start = std::chrono::steady_clock::now();
+      bool wrote = false;
+      bool ok = !hasFailed();
+      for (Batch &b : work) {
+        if (!ok)
+          break;
+        if (b.checkpoint) {
+          ok = (!wrote || ::fdatasync(journalFd) == 0) &&
+               writeCheckpoint(b) && startJournal(b.generation);
+          wrote = false;
+          std::lock_guard lock(mutex);
+          ioStats.checkpoints += ok;
+        } else if (journalFd >= 0) {
+          // Before the first checkpoint there is no journal yet; that
+          // checkpoint covers these records.
+          ok = writeBatch(b);
+          wrote = true;
+        }
+        done = std::max(done, b.sequence);
+      }
+      if (ok && wrote)
+        ok = ::fdatasync(journalFd) == 0;
+      std::chrono::duration<double> took =
+          std::chrono::steady_clock::now() - start;
+      {
+        std::lock_guard lock(mutex);
+        if (ok) {
+          durable = std::max(durable, done);
+        } else {
+          failed = true;
+        }
+        if (wrote) {
+          ioStats.commits++;
+          ioStats.lastCommitSeconds = took.count();
+        }
+      }
+      durableWake.notify_all();
+      if (last)
+        return;
+    }
+  }
+
+  // Written beside the old one and renamed over it, so a crash leaves
+  // either the old or the new checkpoint, never half of one.
+  bool writeCheckpoint(const Batch &b) {
+    codec::Writer w;
+    w.u64(CHECKPOINT_MAGIC);
+    w.u64(b.generation);
+    w.f64(b.clock);
+    w.u64(b.checkpoint->size());
+    for (const auto &record : *b.checkpoint)
+      codec::writeRecord(w, record);
+    return replaceFile(checkpointPath(), w.bytes);
+  }
+
+  bool writeBatch(const Batch &b) {
+    if (!b.changes.empty()) {
+      codec::Writer frames;
+      codec::Writer w;
+      for (const Change &c : b.changes) {
+        w.bytes.clear();
+        c.write(w);
+        frame(frames, w);
+      }
+      if (!writeAll(journalFd, frames.bytes.data(), frames.bytes.size()))
+        return false;
+    }
+    return writeAll(journalFd, b.frames.data(), b.frames.size());
+  }
+
+  bool startJournal(uint64_t gen) {
+    codec::Writer w;
+    w.u64(JOURNAL_MAGIC);
+    w.u64(gen);
+    if (!replaceFile(journalPath(), w.bytes))
+      return false;
+    if (journalFd >= 0)
+      ::close(journalFd);
+    journalFd = ::open(journalPath().c_str(), O_WRONLY | O_APPEND);
+    return journalFd >= 0;
+  }
+
+  bool replaceFile(const std::filesystem::path &path,
+                   const std::vector<uint8_t> &bytes) {
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      return false;
+    bool ok = writeAll(fd, bytes.data(), bytes.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0)
+      return false;
+    // Makes the rename itself durable.
+    int dir = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir >= 0) {
+      ::fsync(dir);
+      ::close(dir);
+    }
+    return true;
+  }
+
+  static bool writeAll(int fd, const uint8_t *data, size_t size) {
+    while (size > 0) {
+      ssize_t n = ::write(fd, data, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      data += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  static std::vector<uint8_t> readFile(const std::filesystem::path &path) {
+    std::vector<uint8_t> bytes;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return bytes;
+    uint8_t chunk[1 << 16];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) > 0)
+      bytes.insert(bytes.end(), chunk, chunk + n);
+    ::close(fd);
+    return bytes;
+  }
+
+  std::filesystem::path directory;
+
+  // Simulation thread only.
+  std::vector<Logged> logged;
+  std::unique_ptr<Capture> capture;
+  size_t nextScan = 0;
+  double pending = 0.0; // objects owed to the current scan or capture
+  bool needsCheckpoint = false;
+  bool resumeJournal = false;
+  uint64_t generation = 0;
+  uint64_t journalSize = 0;
+
+  // Shared, under mutex.
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable durableWake;
+  std::deque<Batch> queue;
+  uint64_t appended = 0; // records
+  uint64_t enqueued = 0; // records and checkpoints; `durable` catches up
+  uint64_t durable = 0;
+  bool flushNow = false;
+  bool stopping = false;
+  bool failed = false;
+  Stats ioStats;
+
+  // I/O thread only.
+  std::thread worker;
+  int journalFd = -1;
+};
+
+} // namespace journal
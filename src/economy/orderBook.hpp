@@ -0,0 +1,307 @@
+#pragma once
+#include "persistent.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace market {
+
+enum class Side : uint8_t { Buy, Sell };
+
+struct Trade {
+  uint64_t buyId;
+  uint64_t sellId;
+  uint32_t buyOwner;
+  uint32_t sellOwner;
+  int64_t price; // ticks
+  uint32_t quantity;
+  Side aggressor;
+};
+
+// Price-time priority limit order book over integer price ticks.
+//
+// Orders live in one pooled vector and are chained per price level through
+// 32-bit indices, so placing or cancelling an order never allocates once
+// the pool has grown to the working set. Levels sit in a dense ladder
+// indexed by tick, with a bitmap per side to find the next non-empty level
+// a word at a time after the touch empties. All of it sits in copy-on-write
+// columns, so copying a book is cheap and the copy only diverges in the
+// chunks that later orders touch.
+class OrderBook {
+public:
+  using OrderId = uint64_t;
+  static constexpr OrderId NO_ORDER = 0;
+  static constexpr int64_t NO_PRICE = -1;
+  // Highest accepted price is MAX_TICKS - 1.
+  static constexpr int64_t MAX_TICKS = int64_t{1} << 22;
+
+  explicit OrderBook(size_t initialTicks = 1 << 12) {
+    growLadder(static_cast<int64_t>(initialTicks));
+  }
+
+  // Matches against the opposite side up to `price`, then rests whatever is
+  // left. Returns the resting order's id, or NO_ORDER if it filled
+  // completely or the price is out of range.
+  OrderId limit(Side side, int64_t price, uint32_t quantity,
+                uint32_t owner = 0) {
+    if (price < 0 || price >= MAX_TICKS || quantity == 0)
+      return NO_ORDER;
+    if (price >= ladderSize())
+      growLadder(price + 1);
+
+    quantity = match(side, price, quantity, owner);
+    if (quantity == 0)
+      return NO_ORDER;
+    return rest(side, price, quantity, owner);
+  }
+
+  // Fills against the opposite side at any price; returns the filled amount.
+  uint32_t market(Side side, uint32_t quantity, uint32_t owner = 0) {
+    int64_t limitPrice = side == Side::Buy ? MAX_TICKS : -1;
+    return quantity - match(side, limitPrice, quantity, owner);
+  }
+
+  bool cancel(OrderId id) {
+    uint32_t index = static_cast<uint32_t>(id);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+    if (index >= orders.size() || orders[index].generation != generation ||
+        orders[index].quantity == 0)
+      return false;
+
+    Order &o = orders.mut(index);
+    Level &level = levelsFor(o.side).mut(o.price);
+    level.quantity -= o.quantity;
+    unlink(level, index);
+    if (level.head == NIL)
+      emptied(o.side, o.price);
+    release(index);
+    return true;
+  }
+
+  // Unfilled quantity of a resting order; 0 once it has filled or been
+  // cancelled.
+  uint32_t remaining(OrderId id) const {
+    uint32_t index = static_cast<uint32_t>(id);
+    if (index >= orders.size() ||
+        orders[index].generation != static_cast<uint32_t>(id >> 32))
+      return 0;
+    return orders[index].quantity;
+  }
+
+  int64_t bestBid() const { return bidTop; }
+  int64_t bestAsk() const { return askTop; }
+
+  uint64_t depth(Side side, int64_t price) const {
+    const auto &levels = side == Side::Buy ? bids : asks;
+    if (price < 0 || price >= ladderSize())
+      return 0;
+    return levels[price].quantity;
+  }
+
+  size_t orderCount() const { return liveOrders; }
+
+  // Trade prints since the last drain, oldest first.
+  const std::vector<Trade> &trades() const { return prints; }
+  void clearTrades() { prints.clear(); }
+
+  // Heap bytes a copy duplicates; the ladders and orders are copy-on-write.
+  size_t heapBytes() const { return prints.capacity() * sizeof(Trade); }
+
+private:
+  static constexpr uint32_t NIL = UINT32_MAX;
+
+  struct Order {
+    int64_t price;
+    uint32_t quantity;
+    uint32_t next;
+    uint32_t prev;
+    uint32_t owner;
+    uint32_t generation;
+    Side side;
+  };
+
+  struct Level {
+    uint64_t quantity = 0;
+    uint32_t head = NIL;
+    uint32_t tail = NIL;
+  };
+
+  int64_t ladderSize() const { return static_cast<int64_t>(bids.size()); }
+
+  void growLadder(int64_t minTicks) {
+    size_t size = bids.empty() ? 64 : bids.size();
+    while (static_cast<int64_t>(size) < minTicks)
+      size *= 2;
+    size = (size + 63) / 64 * 64;
+    bids.resize(size);
+    asks.resize(size);
+    bidBits.resize(size / 64, 0);
+    askBits.resize(size / 64, 0);
+  }
+
+  persistent::Column<Level> &levelsFor(Side side) {
+    return side == Side::Buy ? bids : asks;
+  }
+
+  // The aggressor has no id yet (it only gets one if it rests), so its side
+  // of each print carries NO_ORDER.
+  uint32_t match(Side side, int64_t price, uint32_t quantity, uint32_t owner) {
+    bool buying = side == Side::Buy;
+    persistent::Column<Level> &book = buying ? asks : bids;
+
+    while (quantity > 0) {
+      int64_t top = buying ? askTop : bidTop;
+      if (top == NO_PRICE || (buying ? top > price : top < price))
+        break;
+
+      Level &level = book.mut(top);
+      while (quantity > 0 && level.head != NIL) {
+        uint32_t index = level.head;
+        Order &resting = orders.mut(index);
+        uint32_t fill = std::min(quantity, resting.quantity);
+        OrderId restingId = idOf(index);
+
+        prints.push_back({buying ? NO_ORDER : restingId,
+                          buying ? restingId : NO_ORDER,
+                          buying ? owner : resting.owner,
+                          buying ? resting.owner : owner, top, fill, side});
+
+        quantity -= fill;
+        resting.quantity -= fill;
+        level.quantity -= fill;
+        if (resting.quantity == 0) {
+          unlink(level, index);
+          release(index);
+        }
+      }
+      if (level.head == NIL)
+        emptied(buying ? Side::Sell : Side::Buy, top);
+    }
+    return quantity;
+  }
+
+  OrderId rest(Side side, int64_t price, uint32_t quantity, uint32_t owner) {
+    uint32_t index = acquire();
+    Order &o = orders.mut(index);
+    o.price = price;
+    o.quantity = quantity;
+    o.owner = owner;
+    o.side = side;
+    o.next = NIL;
+
+    Level &level = levelsFor(side).mut(price);
+    o.prev = level.tail;
+    if (level.tail != NIL)
+      orders.mut(level.tail).next = index;
+    else
+      level.head = index;
+    level.tail = index;
+    level.quantity += quantity;
+
+    if (side == Side::Buy) {
+      bidBits.mut(price / 64) |= uint64_t{1} << (price % 64);
+      if (bidTop == NO_PRICE || price > bidTop)
+        bidTop = price;
+    } else {
+      askBits.mut(price / 64) |= uint64_t{1} << (price % 64);
+      if (askTop == NO_PRICE || price < askTop)
+        askTop = price;
+    }
+    return idOf(index);
+  }
+
+  void unlink(Level &level, uint32_t index) {
+    uint32_t prev = orders[index].prev;
+    uint32_t next = orders[index].next;
+    if (prev != NIL)
+      orders.mut(prev).next = next;
+    else
+      level.head = next;
+    if (next != NIL)
+      orders.mut(next).prev = prev;
+    else
+      level.tail = prev;
+  }
+
+  // Clears the level's bit and moves the touch if that level was it.
+  void emptied(Side side, int64_t price) {
+    if (side == Side::Buy) {
+      bidBits.mut(price / 64) &= ~(uint64_t{1} << (price % 64));
+      if (price == bidTop)
+        bidTop = highestBelow(bidBits, price);
+    } else {
+      askBits.mut(price / 64) &= ~(uint64_t{1} << (price % 64));
+      if (price == askTop)
+        askTop = lowestAbove(askBits, price);
+    }
+  }
+
+  static int64_t lowestAbove(const persistent::Column<uint64_t> &bits,
+                             int64_t price) {
+    size_t word = static_cast<size_t>(price / 64);
+    uint64_t mask = bits[word] & (~uint64_t{0} << (price % 64));
+    while (mask == 0) {
+      if (++word == bits.size())
+        return NO_PRICE;
+      mask = bits[word];
+    }
+    return static_cast<int64_t>(word * 64 + std::countr_zero(mask));
+  }
+
+  static int64_t highestBelow(const persistent::Column<uint64_t> &bits,
+                              int64_t price) {
+    int64_t word = price / 64;
+    int shift = static_cast<int>(price % 64);
+    uint64_t mask = bits[word] & (shift == 63 ? ~uint64_t{0}
+                                              : (uint64_t{1} << (shift + 1)) -
+                                                    1);
+    while (mask == 0) {
+      if (--word < 0)
+        return NO_PRICE;
+      mask = bits[word];
+    }
+    return word * 64 + 63 - std::countl_zero(mask);
+  }
+
+  OrderId idOf(uint32_t index) const {
+    return (static_cast<uint64_t>(orders[index].generation) << 32) | index;
+  }
+
+  uint32_t acquire() {
+    liveOrders++;
+    if (freeHead != NIL) {
+      uint32_t index = freeHead;
+      freeHead = orders[index].next;
+      return index;
+    }
+    // Generation starts at 1 so no id is ever NO_ORDER.
+    orders.push_back({0, 0, NIL, NIL, 0, 1, Side::Buy});
+    return static_cast<uint32_t>(orders.size() - 1);
+  }
+
+  void release(uint32_t index) {
+    liveOrders--;
+    Order &o = orders.mut(index);
+    o.quantity = 0;
+    o.generation = o.generation == UINT32_MAX ? 1 : o.generation + 1;
+    o.next = freeHead;
+    freeHead = index;
+  }
+
+  persistent::Column<Order> orders;
+  uint32_t freeHead = NIL;
+  size_t liveOrders = 0;
+
+  persistent::Column<Level> bids;
+  persistent::Column<Level> asks;
+  persistent::Column<uint64_t> bidBits;
+  persistent::Column<uint64_t> askBits;
+  int64_t bidTop = NO_PRICE;
+  int64_t askTop = NO_PRICE;
+
+  std::vector<Trade> prints;
+};
+
+} // namespace market
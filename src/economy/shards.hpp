@@ -0,0 +1,389 @@
+#pragma once
+#include "economy/base.hpp"
+#include "economy/codec.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <linux/futex.h>
+#include <new>
+#include <signal.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Splits a set of EconomyObjects across forked worker processes (Linux
+// only). Each worker owns a shard and updates it on its own core; the
+// coordinator only sends ticks and collects per-shard aggregates, all
+// through shared-memory rings. Objects only move when the coordinator
+// rebalances or gathers.
+//
+// A Cluster shards standalone objects, not a whole Economy. Stocks,
+// traders, the event scheduler and the aggregates stay in the process that
+// owns the Economy. Nothing there can reach an object that lives in a
+// shard (boostLevel looks objects up locally), and the objects' state
+// only comes back through gather(). The objects' formulas read their own
+// history only, so shards never need each other's inputs.
+namespace shards {
+
+// Single-producer single-consumer byte ring living in shared memory. A full
+// writer or an empty reader sleeps on a futex word; it is a shared (not
+// process-private) futex, so wakeups cross fork().
+class Ring {
+public:
+  static size_t bytesFor(size_t capacity) { return sizeof(Ring) + capacity; }
+  static Ring *create(void *at, size_t capacity) {
+    return new (at) Ring(capacity);
+  }
+
+  // Both block until done; sizes larger than the ring stream through it.
+  // `peer` is the process on the other end: while waiting on it, the
+  // caller notices if it died instead of sleeping forever.
+  void write(const void *data, size_t size, pid_t peer = 0) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+      uint64_t t = tail.load(std::memory_order_relaxed);
+      waitUntil([&] { return t - head.load() < capacity; }, peer);
+      size_t n = std::min<size_t>(size, capacity - (t - head.load()));
+      copyIn(t, p, n);
+      tail.store(t + n, std::memory_order_release);
+      notify();
+      p += n;
+      size -= n;
+    }
+  }
+
+  void read(void *data, size_t size, pid_t peer = 0) {
+    uint8_t *p = static_cast<uint8_t *>(data);
+    while (size > 0) {
+      uint64_t h = head.load(std::memory_order_relaxed);
+      waitUntil([&] { return tail.load() != h; }, peer);
+      size_t n = std::min<size_t>(size, tail.load() - h);
+      copyOut(h, p, n);
+      head.store(h + n, std::memory_order_release);
+      notify();
+      p += n;
+      size -= n;
+    }
+  }
+
+private:
+  explicit Ring(size_t capacity) : capacity(capacity) {}
+
+  uint8_t *buffer() { return reinterpret_cast<uint8_t *>(this + 1); }
+
+  void copyIn(uint64_t at, const uint8_t *src, size_t n) {
+    size_t offset = at % capacity;
+    size_t first = std::min(n, capacity - offset);
+    std::memcpy(buffer() + offset, src, first);
+    std::memcpy(buffer(), src + first, n - first);
+  }
+  void copyOut(uint64_t at, uint8_t *dst, size_t n) {
+    size_t offset = at % capacity;
+    size_t first = std::min(n, capacity - offset);
+    std::memcpy(dst, buffer() + offset, first);
+    std::memcpy(dst + first, buffer(), n - first);
+  }
+
+  // Sleepers register before re-checking, and notify() bumps `events`
+  // before looking for them, so a wakeup can't fall between the check and
+  // the sleep.
+  template <typename Ready> void waitUntil(Ready ready, pid_t peer) {
+    while (!ready()) {
+      sleepers.fetch_add(1);
+      uint32_t seen = events.load();
+      if (!ready()) {
+        timespec timeout{0, 100'000'000};
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&events), FUTEX_WAIT,
+                seen, peer ? &timeout : nullptr, nullptr, 0);
+      }
+      sleepers.fetch_sub(1);
+      if (peer && !ready() && waitpid(peer, nullptr, WNOHANG) != 0)
+        throw std::runtime_error("shards: worker process exited");
+    }
+  }
+  void notify() {
+    events.fetch_add(1);
+    if (sleepers.load() > 0)
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(&events), FUTEX_WAKE,
+              INT_MAX, nullptr, nullptr, 0);
+  }
+
+  alignas(64) std::atomic<uint64_t> head{0}; // bytes read
+  alignas(64) std::atomic<uint64_t> tail{0}; // bytes written
+  alignas(64) std::atomic<uint32_t> events{0};
+  std::atomic<uint32_t> sleepers{0};
+  size_t capacity;
+};
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+enum MessageKind : uint32_t {
+  TICK,    // f64 dt
+  RECEIVE, // u64 count, objects
+  SEND,    // u64 count: hand the last `count` objects back
+  GATHER,  // copies of every object, which stay put
+  STOP,
+  REPORT,  // u64 objects, u64 cpu nanoseconds, number value total
+  OBJECTS  // u64 count, objects
+};
+
+struct Message {
+  uint32_t kind;
+  std::vector<uint8_t> payload;
+};
+
+inline void send(Ring &ring, uint32_t kind,
+                 const std::vector<uint8_t> &payload = {}, pid_t peer = 0) {
+  uint64_t header[2] = {kind, payload.size()};
+  ring.write(header, sizeof(header), peer);
+  ring.write(payload.data(), payload.size(), peer);
+}
+
+inline Message receive(Ring &ring, pid_t peer = 0) {
+  uint64_t header[2];
+  ring.read(header, sizeof(header), peer);
+  Message m{static_cast<uint32_t>(header[0]),
+            std::vector<uint8_t>(header[1])};
+  ring.read(m.payload.data(), m.payload.size(), peer);
+  return m;
+}
+
+inline void writeObjects(codec::Writer &w, const EconomyObject *objects,
+                         size_t count) {
+  w.u64(count);
+  for (size_t i = 0; i < count; i++)
+    codec::writeObject(w, objects[i]);
+}
+
+inline void readObjects(codec::Reader &r, std::vector<EconomyObject> &into) {
+  uint64_t count = r.u64();
+  into.reserve(into.size() + count);
+  for (uint64_t i = 0; i < count; i++)
+    into.push_back(codec::readObject(r));
+}
+
+// Thread CPU time rather than wall time, so a worker's cost isn't inflated
+// by waiting for a core.
+inline uint64_t cpuNanos() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// The worker process: serves commands until STOP, then exits without
+// running the parent's atexit handlers or destructors.
+[[noreturn]] inline void workerMain(Ring &in, Ring &out) {
+  std::vector<EconomyObject> objects;
+  for (;;) {
+    Message m = receive(in);
+    codec::Reader r(m.payload);
+    codec::Writer w;
+    switch (m.kind) {
+    case TICK: {
+      float dt = static_cast<float>(r.f64());
+      uint64_t start = cpuNanos();
+      EconomyObject::Number total;
+      for (auto &e : objects) {
+        e.update(dt);
+        total += e.value;
+      }
+      w.u64(objects.size());
+      w.u64(cpuNanos() - start);
+      w.number(total);
+      send(out, REPORT, w.bytes);
+      break;
+    }
+    case RECEIVE:
+      readObjects(r, objects);
+      break;
+    case SEND: {
+      size_t count = std::min<size_t>(r.u64(), objects.size());
+      size_t first = objects.size() - count;
+      writeObjects(w, objects.data() + first, count);
+      objects.erase(objects.begin() + first, objects.end());
+      send(out, OBJECTS, w.bytes);
+      break;
+    }
+    case GATHER:
+      writeObjects(w, objects.data(), objects.size());
+      send(out, OBJECTS, w.bytes);
+      break;
+    default:
+      _exit(0);
+    }
+  }
+}
+
+// Owns the worker processes. Ticks are lockstep: tick() returns once every
+// shard has updated and reported. Construct it before starting any threads
+// (fork() only carries the calling thread over).
+class Cluster {
+public:
+  using Number = EconomyObject::Number;
+
+  struct Shard {
+    pid_t pid = 0;
+    Ring *in = nullptr;  // coordinator -> worker
+    Ring *out = nullptr; // worker -> coordinator
+    size_t objects = 0;
+    double cost = 0.0; // smoothed CPU ns per tick
+    Number total;
+  };
+
+  // Ticks between rebalance() calls made by tick(); 0 turns them off.
+  unsigned rebalanceInterval = 30;
+  // Imbalance (slowest shard over the mean) tolerated before moving objects.
+  double tolerance = 0.05;
+
+  Cluster(const std::vector<EconomyObject> &objects, unsigned workers,
+          size_t ringBytes = size_t{1} << 20) {
+    workers = std::max(workers, 1u);
+    size_t ringSize = Ring::bytesFor(ringBytes);
+    mappedBytes = ringSize * 2 * workers;
+    void *mapped = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+      throw std::runtime_error("shards: could not map shared memory");
+    memory = static_cast<uint8_t *>(mapped);
+
+    pid_t parent = getpid();
+    shardList.resize(workers);
+    for (unsigned i = 0; i < workers; i++) {
+      Shard &s = shardList[i];
+      s.in = Ring::create(memory + ringSize * 2 * i, ringBytes);
+      s.out = Ring::create(memory + ringSize * (2 * i + 1), ringBytes);
+      s.pid = fork();
+      if (s.pid < 0)
+        throw std::runtime_error("shards: fork failed");
+      if (s.pid == 0) {
+        // Don't outlive the coordinator.
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid() != parent)
+          _exit(0);
+        workerMain(*s.in, *s.out);
+      }
+    }
+
+    // Contiguous, equal-count shards to start with.
+    size_t begin = 0;
+    for (unsigned i = 0; i < workers; i++) {
+      size_t end = objects.size() * (i + 1) / workers;
+      codec::Writer w;
+      writeObjects(w, objects.data() + begin, end - begin);
+      send(*shardList[i].in, RECEIVE, w.bytes, shardList[i].pid);
+      shardList[i].objects = end - begin;
+      begin = end;
+    }
+  }
+
+  ~Cluster() {
+    for (Shard &s : shardList) {
+      send(*s.in, STOP);
+      waitpid(s.pid, nullptr, 0);
+    }
+    munmap(memory, mappedBytes);
+  }
+
+  Cluster(const Cluster &) = delete;
+  Cluster &operator=(const Cluster &) = delete;
+
+  void tick(double dt) {
+    codec::Writer w;
+    w.f64(dt);
+    for (Shard &s : shardList)
+      send(*s.in, TICK, w.bytes, s.pid);
+    valueTotal = Number();
+    for (Shard &s : shardList) {
+      Message m = expect(s, REPORT);
+      codec::Reader r(m.payload);
+      s.objects = r.u64();
+      double nanos = static_cast<double>(r.u64());
+      s.total = r.number();
+      s.cost = ticks == 0 ? nanos : s.cost + 0.2 * (nanos - s.cost);
+      valueTotal += s.total;
+    }
+    ticks++;
+    if (rebalanceInterval && ticks % rebalanceInterval == 0)
+      rebalance();
+  }
+
+  // Moves objects from the shard with the highest measured cost to the one
+  // with the lowest, sized to bring both toward the mean. Returns how many
+  // objects moved.
+  size_t rebalance() {
+    if (shardList.size() < 2 || ticks == 0)
+      return 0;
+    auto [lo, hi] = std::minmax_element(
+        shardList.begin(), shardList.end(),
+        [](const Shard &a, const Shard &b) { return a.cost < b.cost; });
+    double mean = 0.0;
+    for (const Shard &s : shardList)
+      mean += s.cost / shardList.size();
+    if (hi->objects < 2 || hi->cost <= mean * (1.0 + tolerance))
+      return 0;
+
+    double perObject = hi->cost / hi->objects;
+    double excess = std::min(hi->cost - mean, mean - lo->cost);
+    size_t count = std::min(static_cast<size_t>(excess / perObject),
+                            hi->objects - 1);
+    if (count == 0)
+      return 0;
+    codec::Writer w;
+    w.u64(count);
+    send(*hi->in, SEND, w.bytes, hi->pid);
+    Message m = expect(*hi, OBJECTS);
+    send(*lo->in, RECEIVE, m.payload, lo->pid);
+
+    // Estimates until the next reports come in.
+    hi->objects -= count;
+    lo->objects += count;
+    hi->cost -= perObject * count;
+    lo->cost += perObject * count;
+    migrated += count;
+    return count;
+  }
+
+  // Copies of every object, shard by shard; rebalancing reorders them.
+  std::vector<EconomyObject> gather() {
+    std::vector<EconomyObject> objects;
+    for (Shard &s : shardList)
+      send(*s.in, GATHER, {}, s.pid);
+    for (Shard &s : shardList) {
+      Message m = expect(s, OBJECTS);
+      codec::Reader r(m.payload);
+      readObjects(r, objects);
+    }
+    return objects;
+  }
+
+  // Sum of every object's value as of the last tick.
+  Number total() const { return valueTotal; }
+  const std::vector<Shard> &shards() const { return shardList; }
+  uint64_t tickCount() const { return ticks; }
+  uint64_t migratedObjects() const { return migrated; }
+
+private:
+  Message expect(Shard &s, uint32_t kind) {
+    Message m = receive(*s.out, s.pid);
+    if (m.kind != kind)
+      throw std::runtime_error("shards: unexpected message from worker");
+    return m;
+  }
+
+  uint8_t *memory = nullptr;
+  size_t mappedBytes = 0;
+  std::vector<Shard> shardList;
+  Number valueTotal;
+  uint64_t ticks = 0;
+  uint64_t migrated = 0;
+};
+
+} // namespace shards
@@ -0,0 +1,79 @@
+#pragma once
+#include "economy/economy.hpp"
+#include "persistent.hpp"
+#include "profiler.hpp"
+#include <cstddef>
+#include <deque>
+
+// Rewind history for an Economy. A snapshot is a plain Economy copy, so
+// capture is O(objects): histories, agent columns, order books and timed
+// events are copy-on-write and compiled formulas are shared, but every
+// object's uuid and name strings and formula windows (up to
+// HistoryWindow::MAX_LENGTH samples each) are copied, and so are the market
+// aggregates and the traders' per-object views (about 0.6 ms and 0.5 MB
+// per 1000 objects). The budget counts both kinds: the live copy-on-write
+// chunks, which grow with what the simulation rewrites after a capture,
+// and each snapshot's own copies, measured when it's taken. Past it, the
+// oldest snapshots are dropped.
+class Timeline {
+public:
+  struct Snapshot {
+    double time;
+    Economy state;
+    size_t bytes = 0; // state.heapBytes()
+  };
+
+  explicit Timeline(size_t budgetBytes = size_t{256} << 20,
+                    double interval = 1.0)
+      : budget(budgetBytes), interval(interval) {}
+
+  // Advances the clock and takes a snapshot every `interval` seconds.
+  void update(const Economy &economy, double dt) {
+    time += dt;
+    if (snapshots.empty() || time - snapshots.back().time >= interval)
+      capture(economy);
+  }
+
+  void capture(const Economy &economy) {
+    PROFILE_SCOPE("Timeline::capture");
+    snapshots.push_back({time, economy});
+    snapshots.back().bytes = snapshots.back().state.heapBytes();
+    copiedBytes += snapshots.back().bytes;
+    trim();
+  }
+
+  // Replaces the economy with snapshot i and forgets the ones after it, so
+  // the simulation carries on from there as a new branch.
+  void restore(size_t i, Economy &economy) {
+    if (i >= snapshots.size())
+      return;
+    economy = snapshots[i].state;
+    time = snapshots[i].time;
+    while (snapshots.size() > i + 1) {
+      copiedBytes -= snapshots.back().bytes;
+      snapshots.pop_back();
+    }
+  }
+
+  size_t size() const { return snapshots.size(); }
+  const Snapshot &operator[](size_t i) const { return snapshots[i]; }
+  double now() const { return time; }
+  // What the snapshots hold: the copies they own plus every live chunk
+  // (the running economy's included).
+  size_t bytes() const { return persistent::liveBytes() + copiedBytes; }
+
+  size_t budget;
+  double interval;
+
+private:
+  void trim() {
+    while (snapshots.size() > 1 && bytes() > budget) {
+      copiedBytes -= snapshots.front().bytes;
+      snapshots.pop_front();
+    }
+  }
+
+  std::deque<Snapshot> snapshots;
+  size_t copiedBytes = 0;
+  double time = 0.0;
+};
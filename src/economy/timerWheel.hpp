@@ -0,0 +1,271 @@
+#pragma once
+#include "persistent.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+namespace events {
+
+// Hierarchical timing wheel over integer ticks: four levels of 256 slots,
+// each level's slot spanning 256 times the one below, plus an overflow list
+// for deadlines more than 2^32 ticks out. Scheduling and cancelling are
+// O(1). A pending event is only touched again when its slot cascades to a
+// finer level (at most three times) and when it fires, so idle events cost
+// nothing per tick. advanceTo() jumps straight to the next occupied slot or
+// cascade point.
+//
+// Events live in a pooled, copy-on-write node list chained through 32-bit
+// indices, so copying a wheel (for a Timeline snapshot) is cheap. Callbacks
+// are copied along with it, so they should find their targets through the
+// Context (by index or uuid) rather than capture pointers into it.
+template <typename Context> class TimerWheel {
+public:
+  using EventId = uint64_t;
+  using Callback = std::function<void(Context &)>;
+  static constexpr EventId NO_EVENT = 0;
+
+  TimerWheel() : buckets(BUCKETS, Bucket{}) {}
+
+  uint64_t now() const { return current; }
+  size_t pending() const { return liveEvents; }
+
+  // Runs `callback` once the wheel reaches `deadline`. Deadlines at or before
+  // the current tick fire on the next one, so an event never runs during the
+  // tick that scheduled it.
+  EventId at(uint64_t deadline, Callback callback) {
+    uint32_t index = acquire();
+    Node &n = nodes.mut(index);
+    n.deadline = std::max(deadline, current + 1);
+    n.callback = std::move(callback);
+    place(index);
+    return idOf(index);
+  }
+
+  EventId after(uint64_t delay, Callback callback) {
+    return at(current + delay, std::move(callback));
+  }
+
+  // False if the event already fired or was cancelled.
+  bool cancel(EventId id) {
+    uint32_t index = static_cast<uint32_t>(id);
+    if (index >= nodes.size() ||
+        nodes[index].generation != static_cast<uint32_t>(id >> 32) ||
+        nodes[index].bucket == FREE)
+      return false;
+    unlink(index);
+    release(index);
+    return true;
+  }
+
+  // Fires everything due up to and including `target`, in deadline order
+  // (events sharing a tick run in a fixed but unspecified order). Returns
+  // the number of events fired.
+  size_t advanceTo(Context &context, uint64_t target) {
+    size_t fired = 0;
+    while (current < target) {
+      if (liveEvents == 0) {
+        current = target;
+        break;
+      }
+      uint64_t next = std::min(nextWorkTick(), target);
+      current = next;
+      if ((current & MASK) == 0)
+        cascade();
+      uint16_t slot = static_cast<uint16_t>(current & MASK);
+      if (buckets[slot].head != NIL)
+        fired += fire(context, slot);
+    }
+    return fired;
+  }
+
+private:
+  static constexpr unsigned BITS = 8;
+  static constexpr uint64_t SLOTS = uint64_t{1} << BITS;
+  static constexpr uint64_t MASK = SLOTS - 1;
+  static constexpr unsigned LEVELS = 4;
+  static constexpr uint16_t OVERFLOW_BUCKET = LEVELS * SLOTS;
+  // Holds the slot currently being fired, so callbacks can cancel events
+  // that are due in the same batch.
+  static constexpr uint16_t FIRING = OVERFLOW_BUCKET + 1;
+  static constexpr uint16_t BUCKETS = FIRING + 1;
+  static constexpr uint16_t FREE = UINT16_MAX;
+  static constexpr uint32_t NIL = UINT32_MAX;
+
+  struct Node {
+    uint64_t deadline = 0;
+    Callback callback;
+    uint32_t next = NIL;
+    uint32_t prev = NIL;
+    uint32_t generation = 1;
+    uint16_t bucket = FREE;
+  };
+
+  struct Bucket {
+    uint32_t head = NIL;
+    uint32_t tail = NIL;
+  };
+
+  EventId idOf(uint32_t index) const {
+    return (static_cast<uint64_t>(nodes[index].generation) << 32) | index;
+  }
+
+  void place(uint32_t index) {
+    uint64_t deadline = nodes[index].deadline;
+    uint64_t delta = deadline - current;
+    uint16_t bucket = OVERFLOW_BUCKET;
+    for (unsigned level = 0; level < LEVELS; level++) {
+      if (delta < (uint64_t{1} << (BITS * (level + 1)))) {
+        bucket = static_cast<uint16_t>(level * SLOTS +
+                                       ((deadline >> (BITS * level)) & MASK));
+        break;
+      }
+    }
+    append(bucket, index);
+  }
+
+  void append(uint16_t bucket, uint32_t index) {
+    Node &n = nodes.mut(index);
+    Bucket &b = buckets.mut(bucket);
+    n.bucket = bucket;
+    n.next = NIL;
+    n.prev = b.tail;
+    if (b.tail != NIL)
+      nodes.mut(b.tail).next = index;
+    else
+      b.head = index;
+    b.tail = index;
+    if (bucket < OVERFLOW_BUCKET)
+      occupied[bucket / 64] |= uint64_t{1} << (bucket % 64);
+  }
+
+  void unlink(uint32_t index) {
+    uint16_t bucket = nodes[index].bucket;
+    uint32_t prev = nodes[index].prev;
+    uint32_t next = nodes[index].next;
+    Bucket &b = buckets.mut(bucket);
+    if (prev != NIL)
+      nodes.mut(prev).next = next;
+    else
+      b.head = next;
+    if (next != NIL)
+      nodes.mut(next).prev = prev;
+    else
+      b.tail = prev;
+    if (b.head == NIL && bucket < OVERFLOW_BUCKET)
+      occupied[bucket / 64] &= ~(uint64_t{1} << (bucket % 64));
+  }
+
+  // The next tick with anything to do. Slots at or behind a level's current
+  // index belong to its next rotation, so if a level only has those, the
+  // answer is that level's wrap; if it is empty, the next level decides.
+  uint64_t nextWorkTick() const {
+    for (unsigned level = 0; level < LEVELS; level++) {
+      unsigned shift = BITS * level;
+      uint64_t index = (current >> shift) & MASK;
+      uint64_t rotation = current & ~((SLOTS << shift) - 1);
+      int64_t ahead = nextOccupied(level, index + 1);
+      if (ahead >= 0)
+        return rotation + (static_cast<uint64_t>(ahead) << shift);
+      if (nextOccupied(level, 0) >= 0)
+        return rotation + (SLOTS << shift);
+    }
+    return (current | ((uint64_t{1} << (BITS * LEVELS)) - 1)) + 1;
+  }
+
+  // First occupied slot of `level` at or after `from`, or -1.
+  int64_t nextOccupied(unsigned level, uint64_t from) const {
+    for (uint64_t slot = from; slot < SLOTS;) {
+      uint64_t bit = level * SLOTS + slot;
+      uint64_t word = occupied[bit / 64] >> (bit % 64);
+      if (word != 0)
+        return static_cast<int64_t>(slot + std::countr_zero(word));
+      slot = (slot / 64 + 1) * 64;
+    }
+    return -1;
+  }
+
+  // Redistributes the upper-level slots that come due at this wrap, highest
+  // level first so their events can land in the slots cascaded next.
+  void cascade() {
+    unsigned top = 1;
+    while (top < LEVELS && ((current >> (BITS * top)) & MASK) == 0)
+      top++;
+    if (top == LEVELS)
+      redistribute(OVERFLOW_BUCKET);
+    for (unsigned level = std::min(top, LEVELS - 1); level >= 1; level--)
+      redistribute(static_cast<uint16_t>(
+          level * SLOTS + ((current >> (BITS * level)) & MASK)));
+  }
+
+  void redistribute(uint16_t bucket) {
+    uint32_t index = buckets[bucket].head;
+    buckets.mut(bucket) = Bucket{};
+    if (bucket < OVERFLOW_BUCKET)
+      occupied[bucket / 64] &= ~(uint64_t{1} << (bucket % 64));
+    while (index != NIL) {
+      uint32_t next = nodes[index].next;
+      place(index);
+      index = next;
+    }
+  }
+
+  // Moves the slot's list aside and runs it front to back. Events a callback
+  // schedules land in later ticks; events it cancels are unlinked from the
+  // batch like from any slot.
+  size_t fire(Context &context, uint16_t slot) {
+    Bucket batch = buckets[slot];
+    buckets.mut(slot) = Bucket{};
+    occupied[slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    buckets.mut(FIRING) = batch;
+    for (uint32_t index = batch.head; index != NIL;
+         index = nodes[index].next)
+      nodes.mut(index).bucket = FIRING;
+
+    size_t fired = 0;
+    while (buckets[FIRING].head != NIL) {
+      uint32_t index = buckets[FIRING].head;
+      unlink(index);
+      Callback callback = std::move(nodes.mut(index).callback);
+      release(index);
+      callback(context);
+      fired++;
+    }
+    return fired;
+  }
+
+  uint32_t acquire() {
+    liveEvents++;
+    if (freeHead != NIL) {
+      uint32_t index = freeHead;
+      freeHead = nodes[index].next;
+      return index;
+    }
+    nodes.push_back(Node{});
+    return static_cast<uint32_t>(nodes.size() - 1);
+  }
+
+  void release(uint32_t index) {
+    liveEvents--;
+    Node &n = nodes.mut(index);
+    n.callback = nullptr;
+    n.bucket = FREE;
+    // Generation starts at 1 so no id is ever NO_EVENT.
+    n.generation = n.generation == UINT32_MAX ? 1 : n.generation + 1;
+    n.next = freeHead;
+    freeHead = index;
+  }
+
+  persistent::Column<Node> nodes;
+  persistent::Column<Bucket> buckets;
+  // One bit per non-empty wheel slot (the overflow list isn't tracked).
+  std::array<uint64_t, LEVELS * SLOTS / 64> occupied{};
+  uint32_t freeHead = NIL;
+  size_t liveEvents = 0;
+  uint64_t current = 0;
+};
+
+} // namespace events
@@ -1,12 +1,21 @@
 #pragma once
+#include "bigNumber.hpp"
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
 #include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 namespace functionlang {
 
-const char VERSION[] = "0.2.1";
+const char VERSION[] = "0.5.0";
 
 enum UNARY_OPS_ENUM {
   LOG = 'l',
@@ -38,6 +47,16 @@ enum BINARY_OPS_ENUM {
   ROUND = '~'
 };
 enum TERNARY_OPS_ENUM { WHETHER = '?' };
+// Aggregates over the last [n] history samples; n is a literal, e.g. A16,
+// from 1 to HistoryWindow::MAX_LENGTH.
+enum WINDOW_OPS_ENUM {
+  W_MEAN = 'A',
+  W_SUM = 'U',
+  W_MIN = 'N',
+  W_MAX = 'X',
+  W_VAR = 'D',
+  W_EMA = 'E'
+};
 
 const char UNARY_OPS[] = {
     UNARY_OPS_ENUM::LOG,  UNARY_OPS_ENUM::LOG2, UNARY_OPS_ENUM::LOG10,
@@ -51,13 +70,371 @@ const char BINARY_OPS[] = {
     BINARY_OPS_ENUM::L_AND, BINARY_OPS_ENUM::L_OR,  BINARY_OPS_ENUM::MOD,
     BINARY_OPS_ENUM::ROUND};
 const char TERNARY_OPS[] = {TERNARY_OPS_ENUM::WHETHER};
+const char WINDOW_OPS[] = {WINDOW_OPS_ENUM::W_MEAN, WINDOW_OPS_ENUM::W_SUM,
+                           WINDOW_OPS_ENUM::W_MIN,  WINDOW_OPS_ENUM::W_MAX,
+                           WINDOW_OPS_ENUM::W_VAR,  WINDOW_OPS_ENUM::W_EMA};
+
+// Running statistics over the last `length` samples. push() is O(1)
+// amortized (min/max use monotonic queues, sums are re-based once per
+// wrap to stop drift), and every read is O(1). The variance sums are taken
+// around a reference value, re-chosen as the mean at every re-base, so
+// large values that barely move don't cancel out to noise.
+template <typename Number = double> class HistoryWindow {
+public:
+  // Longer windows in a formula evaluate to 0, like non-positive ones.
+  static constexpr long MAX_LENGTH = 1 << 16;
+
+  explicit HistoryWindow(size_t length)
+      : length(length), ring(length), minQueue(length), maxQueue(length),
+        alpha(2.0 / (length + 1.0)) {}
+
+  void push(Number v) {
+    uint64_t index = pushed++;
+    size_t slot = index % length;
+    if (count == length) {
+      Number d = ring[slot] - reference;
+      total -= ring[slot];
+      offset -= d;
+      offsetSq -= d * d;
+    } else {
+      if (count == 0)
+        reference = v;
+      count++;
+    }
+    ring[slot] = v;
+    Number d = v - reference;
+    total += v;
+    offset += d;
+    offsetSq += d * d;
+    if (slot == length - 1)
+      rebase();
+
+    pushMonotonic(minQueue, minHead, minSize, index,
+                  [&](Number q) { return q >= v; });
+    pushMonotonic(maxQueue, maxHead, maxSize, index,
+                  [&](Number q) { return q <= v; });
+
+    ema = emaSeeded ? ema + alpha * (v - ema) : v;
+    emaSeeded = true;
+  }
+
+  size_t getLength() const { return length; }
+  Number sum() const { return total; }
+  Number mean() const {
+    return count ? total / static_cast<double>(count) : Number(0.0);
+  }
+  Number min() const {
+    return minSize ? at(minQueue[minHead]) : Number(0.0);
+  }
+  Number max() const {
+    return maxSize ? at(maxQueue[maxHead]) : Number(0.0);
+  }
+  Number variance() const {
+    if (count == 0)
+      return Number(0.0);
+    Number m = offset / static_cast<double>(count);
+    return std::max(Number(0.0),
+                    offsetSq / static_cast<double>(count) - m * m);
+  }
+  Number movingAverage() const { return ema; }
+
+  // Heap bytes a copy duplicates: the ring and both queues.
+  size_t heapBytes() const {
+    return ring.capacity() * sizeof(Number) +
+           (minQueue.capacity() + maxQueue.capacity()) * sizeof(uint64_t);
+  }
+
+  // Hands every field push() maintains to io(field), so a codec can save
+  // the window and put it back exactly (the EMA remembers more than the
+  // history holds). The length isn't included; it comes from the formula.
+  template <typename IO> void transfer(IO &&io) { fields(*this, io); }
+  template <typename IO> void transfer(IO &&io) const { fields(*this, io); }
+  // Whether transferred-in counters fit the window (a corrupt record).
+  bool consistent() const {
+    return count <= length && minHead < length && minSize <= length &&
+           maxHead < length && maxSize <= length;
+  }
+
+private:
+  template <typename Self, typename IO> static void fields(Self &w, IO &io) {
+    io(w.ring);
+    io(w.count);
+    io(w.pushed);
+    io(w.total);
+    io(w.reference);
+    io(w.offset);
+    io(w.offsetSq);
+    io(w.minQueue);
+    io(w.minHead);
+    io(w.minSize);
+    io(w.maxQueue);
+    io(w.maxHead);
+    io(w.maxSize);
+    io(w.ema);
+    io(w.emaSeeded);
+  }
+
+  Number at(uint64_t index) const { return ring[index % length]; }
+
+  void rebase() {
+    total = Number(0.0);
+    for (size_t i = 0; i < count; i++)
+      total += ring[i];
+    reference = mean();
+    offset = Number(0.0);
+    offsetSq = Number(0.0);
+    for (size_t i = 0; i < count; i++) {
+      Number d = ring[i] - reference;
+      offset += d;
+      offsetSq += d * d;
+    }
+  }
+
+  // Fixed-capacity deque of sample indices whose values are monotonic;
+  // dominated entries are dropped from the back, expired ones from the
+  // front.
+  template <typename Dominated>
+  void pushMonotonic(std::vector<uint64_t> &queue, size_t &head, size_t &size,
+                     uint64_t index, Dominated dominated) {
+    if (size && queue[head] + length <= index) {
+      head = (head + 1) % length;
+      size--;
+    }
+    while (size && dominated(at(queue[(head + size - 1) % length])))
+      size--;
+    queue[(head + size) % length] = index;
+    size++;
+  }
 
-using ExprFuncRet = const std::vector<double> &;
-using ExprFunc = std::function<double(ExprFuncRet)>;
+  size_t length;
+  std::vector<Number> ring;
+  size_t count = 0;
+  uint64_t pushed = 0;
+  Number total = Number(0.0);
+  Number reference = Number(0.0);
+  Number offset = Number(0.0);   // sum of (v - reference)
+  Number offsetSq = Number(0.0); // sum of (v - reference)^2
+  std::vector<uint64_t> minQueue;
+  size_t minHead = 0, minSize = 0;
+  std::vector<uint64_t> maxQueue;
+  size_t maxHead = 0, maxSize = 0;
+  double alpha;
+  Number ema = Number(0.0);
+  bool emaSeeded = false;
+};
+
+// The windows a compiled formula reads from, one per distinct length. The
+// formula refers to them by index, so it can be shared between any number
+// of WindowSets with the same layout (copies of the one it was parsed
+// with). Whoever owns a set feeds it every new history sample.
+template <typename Number = double> class WindowSet {
+public:
+  // Index of the window of this length, added if it's new.
+  size_t add(size_t length) {
+    for (size_t i = 0; i < windows.size(); i++)
+      if (windows[i].getLength() == length)
+        return i;
+    windows.emplace_back(length);
+    return windows.size() - 1;
+  }
+
+  const HistoryWindow<Number> &operator[](size_t i) const {
+    return windows[i];
+  }
+  HistoryWindow<Number> &operator[](size_t i) { return windows[i]; }
+  size_t size() const { return windows.size(); }
+
+  void push(Number v) {
+    for (auto &w : windows)
+      w.push(v);
+  }
 
-const ExprFunc parseExpression(const char *&ptr) {
+  bool empty() const { return windows.empty(); }
+
+  size_t heapBytes() const {
+    size_t bytes = windows.capacity() * sizeof(HistoryWindow<Number>);
+    for (const auto &w : windows)
+      bytes += w.heapBytes();
+    return bytes;
+  }
+
+private:
+  std::vector<HistoryWindow<Number>> windows;
+};
+
+// Per-node counters for a formula compiled with profiling on. Nodes are kept
+// in parse (pre-)order with their depth, so the tree reads top-down straight
+// from the list. The counters are plain integers, so a profiled formula
+// should only be evaluated from one thread.
+class ExprProfile {
+public:
+  struct Node {
+    char op = '\0'; // operator, 'V' for values, '#' for literals
+    int depth = 0;
+    std::string source; // the subexpression this node parsed
+    uint64_t calls = 0;
+    uint64_t nanos = 0;     // including children
+    uint64_t nonFinite = 0; // NaN or inf results
+    uint64_t guardHits = 0; // DIV/MOD by zero, LOG_N outside its domain
+  };
+
+  const std::deque<Node> &nodes() const { return list; }
+
+  // Time spent in node i itself, children excluded.
+  uint64_t selfNanos(size_t i) const {
+    uint64_t children = 0;
+    for (size_t c = i + 1; c < list.size() && list[c].depth > list[i].depth;
+         c++) {
+      if (list[c].depth == list[i].depth + 1)
+        children += list[c].nanos;
+    }
+    return list[i].nanos - std::min(children, list[i].nanos);
+  }
+
+  void reset() {
+    for (Node &n : list)
+      n.calls = n.nanos = n.nonFinite = n.guardHits = 0;
+  }
+
+  static const char *opName(char op) {
+    switch (op) {
+    case UNARY_OPS_ENUM::LOG:
+      return "log";
+    case UNARY_OPS_ENUM::LOG2:
+      return "log2";
+    case UNARY_OPS_ENUM::LOG10:
+      return "log10";
+    case UNARY_OPS_ENUM::SQRT:
+      return "sqrt";
+    case UNARY_OPS_ENUM::CBRT:
+      return "cbrt";
+    case UNARY_OPS_ENUM::SIN:
+      return "sin";
+    case UNARY_OPS_ENUM::COS:
+      return "cos";
+    case UNARY_OPS_ENUM::ABS:
+      return "abs";
+    case UNARY_OPS_ENUM::NOT:
+      return "not";
+    case BINARY_OPS_ENUM::MUL:
+      return "mul";
+    case BINARY_OPS_ENUM::DIV:
+      return "div";
+    case BINARY_OPS_ENUM::ADD:
+      return "add";
+    case BINARY_OPS_ENUM::SUB:
+      return "sub";
+    case BINARY_OPS_ENUM::POW:
+      return "pow";
+    case BINARY_OPS_ENUM::MIN:
+      return "min";
+    case BINARY_OPS_ENUM::MAX:
+      return "max";
+    case BINARY_OPS_ENUM::LOG_N:
+      return "log_n";
+    case BINARY_OPS_ENUM::LT:
+      return "less";
+    case BINARY_OPS_ENUM::GT:
+      return "greater";
+    case BINARY_OPS_ENUM::EQ:
+      return "equal";
+    case BINARY_OPS_ENUM::NE:
+      return "not equal";
+    case BINARY_OPS_ENUM::L_AND:
+      return "and";
+    case BINARY_OPS_ENUM::L_OR:
+      return "or";
+    case BINARY_OPS_ENUM::MOD:
+      return "mod";
+    case BINARY_OPS_ENUM::ROUND:
+      return "round";
+    case TERNARY_OPS_ENUM::WHETHER:
+      return "whether";
+    case WINDOW_OPS_ENUM::W_MEAN:
+      return "window mean";
+    case WINDOW_OPS_ENUM::W_SUM:
+      return "window sum";
+    case WINDOW_OPS_ENUM::W_MIN:
+      return "window min";
+    case WINDOW_OPS_ENUM::W_MAX:
+      return "window max";
+    case WINDOW_OPS_ENUM::W_VAR:
+      return "window variance";
+    case WINDOW_OPS_ENUM::W_EMA:
+      return "window ema";
+    case 'V':
+      return "value";
+    case '#':
+      return "literal";
+    default:
+      return "empty";
+    }
+  }
+
+  // Called by parseExpression around each node it parses.
+  Node *open() {
+    list.emplace_back();
+    list.back().depth = depth++;
+    return &list.back();
+  }
+  void close(Node *node, const char *begin, const char *end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t'))
+      begin++;
+    node->source.assign(begin, end);
+    char op = begin < end ? *begin : '\0';
+    node->op = std::isdigit(static_cast<unsigned char>(op)) || op == '.' ||
+                       op == '-'
+                   ? '#'
+                   : op;
+    depth--;
+  }
+
+private:
+  std::deque<Node> list; // deque: nodes stay put while the tree is parsed
+  int depth = 0;
+};
+
+// Formulas evaluate in any Number with the arithmetic, comparison and
+// <cmath>-style free functions (found through ADL): double, or
+// util::BigNumber for values that outgrow it. A compiled formula holds no
+// window state of its own; it reads the WindowSet it is called with, laid
+// out like the one it was parsed against (null if it has no windows).
+template <typename Number = double>
+using ExprFuncRet = const std::vector<Number> &;
+template <typename Number = double>
+using ExprWindows = const WindowSet<Number> *;
+template <typename Number = double>
+using ExprFunc =
+    std::function<Number(ExprFuncRet<Number>, ExprWindows<Number>)>;
+
+// Numeric literal at ptr; types with their own parser (BigNumber reads
+// exponents past double's range) use it.
+template <typename Number> Number parseLiteral(const char *&ptr) {
+  char *endPtr;
+  Number val;
+  if constexpr (requires { Number::parse(ptr, &endPtr); })
+    val = Number::parse(ptr, &endPtr);
+  else
+    val = static_cast<Number>(std::strtod(ptr, &endPtr));
+  ptr = endPtr;
+  return val;
+}
+
+template <typename Number = double>
+const ExprFunc<Number> parseExpression(const char *&ptr,
+                                       WindowSet<Number> *windows = nullptr,
+                                       ExprProfile *profile = nullptr);
+
+// One node of the expression at ptr. `node` is its profile entry, or null
+// when compiled without profiling.
+template <typename Number>
+ExprFunc<Number> parseNode(const char *&ptr, WindowSet<Number> *windows,
+                           ExprProfile *profile, ExprProfile::Node *node) {
+  using Args = ExprFuncRet<Number>;
+  using Windows = ExprWindows<Number>;
+  const Number zero(0.0);
   if (ptr == nullptr || *ptr == '\0') {
-    return [](ExprFuncRet) { return 0.0f; };
+    return [zero](Args, Windows) { return zero; };
   }
   while (ptr && (*ptr == ' ' || *ptr == '\t'))
     ptr++;
@@ -71,115 +448,189 @@ const ExprFunc parseExpression(const char *&ptr) {
     // Move the global pointer forward to after the number
     ptr = endPtr;
 
-    return [index](ExprFuncRet args) {
+    return [index, zero](Args args, Windows) {
       // Safety check: ensure index exists in the provided vector
       if (index >= 0 && static_cast<size_t>(index) < args.size()) {
         return args[index];
       }
-      return 0.0; // Default if index is out of bounds
+      return zero; // Default if index is out of bounds
     };
   }
+  if (std::ranges::contains(WINDOW_OPS, op)) {
+    char *endPtr;
+    long length = std::strtol(ptr, &endPtr, 10);
+    ptr = endPtr;
+    if (windows == nullptr || length <= 0 ||
+        length > HistoryWindow<Number>::MAX_LENGTH) {
+      return [zero](Args, Windows) { return zero; };
+    }
+    size_t i = windows->add(static_cast<size_t>(length));
+    switch (op) {
+    case WINDOW_OPS_ENUM::W_MEAN:
+      return [i](Args, Windows w) { return (*w)[i].mean(); };
+    case WINDOW_OPS_ENUM::W_SUM:
+      return [i](Args, Windows w) { return (*w)[i].sum(); };
+    case WINDOW_OPS_ENUM::W_MIN:
+      return [i](Args, Windows w) { return (*w)[i].min(); };
+    case WINDOW_OPS_ENUM::W_MAX:
+      return [i](Args, Windows w) { return (*w)[i].max(); };
+    case WINDOW_OPS_ENUM::W_VAR:
+      return [i](Args, Windows w) { return (*w)[i].variance(); };
+    default:
+      return [i](Args, Windows w) { return (*w)[i].movingAverage(); };
+    }
+  }
   if (std::isdigit(op) || op == '.' || op == '-') {
     ptr--;
-    float val = strtof(ptr, const_cast<char **>(&ptr));
-    return [val](ExprFuncRet) { return val; };
+    Number val = parseLiteral<Number>(ptr);
+    return [val](Args, Windows) { return val; };
   }
-  auto arg1 = parseExpression(ptr);
+  auto arg1 = parseExpression<Number>(ptr, windows, profile);
+
+  // std:: overloads for double; ADL finds the Number's own otherwise.
+  using std::abs, std::cbrt, std::cos, std::fmod, std::log, std::log10,
+      std::log2, std::pow, std::round, std::sin, std::sqrt;
+  const Number one(1.0), minusOne(-1.0);
 
   if (std::ranges::contains(UNARY_OPS, op)) {
-    return [arg1, op](ExprFuncRet args) {
-      float v1 = arg1(args);
+    return [arg1, op, zero, one, minusOne](Args args, Windows w) -> Number {
+      Number v1 = arg1(args, w);
       switch (op) {
       case UNARY_OPS_ENUM::LOG:
-        return std::log(v1);
+        return log(v1);
       case UNARY_OPS_ENUM::LOG2:
-        return std::log2(v1);
+        return log2(v1);
       case UNARY_OPS_ENUM::LOG10:
-        return std::log10(v1);
+        return log10(v1);
       case UNARY_OPS_ENUM::SQRT:
-        return std::sqrt(v1);
+        return sqrt(v1);
       case UNARY_OPS_ENUM::CBRT:
-        return std::cbrt(v1);
+        return cbrt(v1);
       case UNARY_OPS_ENUM::SIN:
-        return std::sin(v1);
+        return sin(v1);
       case UNARY_OPS_ENUM::COS:
-        return std::cos(v1);
+        return cos(v1);
       case UNARY_OPS_ENUM::ABS:
-        return std::abs(v1);
+        return abs(v1);
       case UNARY_OPS_ENUM::NOT:
-        return v1 <= 0.0f ? 1.0f : -1.0f;
+        return v1 <= zero ? one : minusOne;
       default:
-        return 0.0f;
+        return zero;
       };
     };
   } else if (std::ranges::contains(BINARY_OPS, op)) {
     if (*ptr == ',')
       ptr++;
-    auto arg2 = parseExpression(ptr);
-    return [arg1, arg2, op](ExprFuncRet args) {
-      auto v1 = arg1(args);
-      auto v2 = arg2(args);
+    auto arg2 = parseExpression<Number>(ptr, windows, profile);
+    return [arg1, arg2, op, zero, one, minusOne,
+            node](Args args, Windows w) -> Number {
+      const Number epsilon(0.00001);
+      Number v1 = arg1(args, w);
+      Number v2 = arg2(args, w);
+      auto guard = [node] {
+        if (node)
+          node->guardHits++;
+      };
       switch (op) {
       case BINARY_OPS_ENUM::MUL:
         return v1 * v2;
       case BINARY_OPS_ENUM::DIV:
-        return v2 == 0.0 ? 0.0 : v1 / v2;
+        if (v2 == zero) {
+          guard();
+          return zero;
+        }
+        return v1 / v2;
       case BINARY_OPS_ENUM::ADD:
         return v1 + v2;
       case BINARY_OPS_ENUM::SUB:
         return v1 - v2;
       case BINARY_OPS_ENUM::POW:
-        return std::pow(v1, v2);
+        return pow(v1, v2);
       case BINARY_OPS_ENUM::MIN:
         return std::min(v1, v2);
       case BINARY_OPS_ENUM::MAX:
         return std::max(v1, v2);
       case BINARY_OPS_ENUM::LOG_N:
-        if (v2 <= 0.0 || v1 <= 0.0 || v1 == 1.0)
-          return 0.0;
-        return std::log(v2) / std::log(v1);
+        if (v2 <= zero || v1 <= zero || v1 == one) {
+          guard();
+          return zero;
+        }
+        return log(v2) / log(v1);
       case BINARY_OPS_ENUM::LT:
-        return v1 < v2 ? 1.0 : -1.0;
+        return v1 < v2 ? one : minusOne;
       case BINARY_OPS_ENUM::GT:
-        return v1 > v2 ? 1.0 : -1.0;
+        return v1 > v2 ? one : minusOne;
       case BINARY_OPS_ENUM::EQ:
-        return std::abs(v1 - v2) < 0.00001 ? 1.0 : -1.0;
+        return abs(v1 - v2) < epsilon ? one : minusOne;
       case BINARY_OPS_ENUM::NE:
-        return std::abs(v1 - v2) > 0.00001 ? 1.0 : -1.0;
+        return abs(v1 - v2) > epsilon ? one : minusOne;
       case BINARY_OPS_ENUM::L_AND:
-        return (v1 > 0.0) && (v2 > 0.0) ? 1.0 : -1.0;
+        return (v1 > zero) && (v2 > zero) ? one : minusOne;
       case BINARY_OPS_ENUM::L_OR:
-        return (v1 > 0.0) || (v2 > 0.0) ? 1.0 : -1.0;
+        return (v1 > zero) || (v2 > zero) ? one : minusOne;
       case BINARY_OPS_ENUM::MOD:
-        return v2 = 0.0 ? 0.0 : std::fmod(v1, v2);
+        if (v2 == zero) {
+          guard();
+          return zero;
+        }
+        return fmod(v1, v2);
       case BINARY_OPS_ENUM::ROUND: {
-        auto n = std::pow(10.0, v2);
-        return std::round(v1 * n) / n;
+        Number n = pow(Number(10.0), v2);
+        return round(v1 * n) / n;
       }
       default:
-        return 0.0;
+        return zero;
       };
     };
   } else if (std::ranges::contains(TERNARY_OPS, op)) {
     if (*ptr == ',')
       ptr++;
-    auto arg2 = parseExpression(ptr);
+    auto arg2 = parseExpression<Number>(ptr, windows, profile);
     if (*ptr == ',')
       ptr++;
-    auto arg3 = parseExpression(ptr);
-    return [arg1, arg2, arg3, op](ExprFuncRet args) {
-      auto v1 = arg1(args);
-      auto v2 = arg2(args);
-      auto v3 = arg3(args);
+    auto arg3 = parseExpression<Number>(ptr, windows, profile);
+    return [arg1, arg2, arg3, op, zero](Args args, Windows w) -> Number {
+      Number v1 = arg1(args, w);
+      Number v2 = arg2(args, w);
+      Number v3 = arg3(args, w);
       switch (op) {
       case TERNARY_OPS_ENUM::WHETHER:
-        return v1 > 0.0 ? v2 : v3;
+        return v1 > zero ? v2 : v3;
       default:
-        return 0.0;
+        return zero;
       };
     };
   }
 
-  return [](ExprFuncRet) { return 0.0f; };
+  return [zero](Args, Windows) { return zero; };
+}
+
+// Compiles the expression at ptr and advances past it. Window operators
+// register with `windows`; with a `profile`, every node also counts its
+// calls, time and non-finite results there.
+template <typename Number>
+const ExprFunc<Number> parseExpression(const char *&ptr,
+                                       WindowSet<Number> *windows,
+                                       ExprProfile *profile) {
+  if (profile == nullptr)
+    return parseNode<Number>(ptr, windows, nullptr, nullptr);
+  const char *begin = ptr;
+  ExprProfile::Node *node = profile->open();
+  ExprFunc<Number> inner = parseNode<Number>(ptr, windows, profile, node);
+  profile->close(node, begin, ptr);
+  return [inner, node](ExprFuncRet<Number> args, ExprWindows<Number> w) {
+    using Clock = std::chrono::steady_clock;
+    using std::isfinite;
+    auto start = Clock::now();
+    Number v = inner(args, w);
+    node->nanos += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start)
+            .count());
+    node->calls++;
+    if (!isfinite(v))
+      node->nonFinite++;
+    return v;
+  };
 }
 } // namespace functionlang
@@ -0,0 +1,137 @@
+#pragma once
+#include "economy/base.hpp"
+#include "metrics.hpp"
+#include "utils.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace gambling {
+
+// A die multiplies the wagered value by a per-face factor. The factors are
+// computed once at construction so rolling is a table lookup, and the same
+// table gives the exact statistics (every face is equally likely).
+class Dice {
+public:
+  // multiplier(face) = pow(base, (face - center) / spread), face in [1, faces]
+  Dice(const char *name, int faces, double base, double center, double spread)
+      : m_name(name), m_multipliers(faces) {
+    for (int n = 1; n <= faces; ++n) {
+      m_multipliers[n - 1] = std::pow(base, (n - center) / spread);
+    }
+  }
+
+  // Single-faced die with a fixed multiplier.
+  Dice(const char *name, double multiplier)
+      : m_name(name), m_multipliers(1, multiplier) {}
+
+  // --- Standard Set ---
+  static const Dice &d20() {
+    static const Dice d("d20", 20, 2.0, 15.0, 6.7); // if > d15, mult up
+    return d;
+  }
+  static const Dice &d10() {
+    static const Dice d("d10", 10, 1.2, 4.6, 3.1);
+    return d;
+  }
+  static const Dice &d4() {
+    static const Dice d("d4", 4, 2.0, 2.9, 14.1);
+    return d;
+  }
+  static const Dice &d1() {
+    static const Dice d("d1", 1.0);
+    return d;
+  }
+  static const Dice &d0() {
+    static const Dice d("d0", 0.9);
+    return d;
+  }
+  static const std::array<const Dice *, 5> &standardSet() {
+    static const std::array<const Dice *, 5> set = {&d20(), &d10(), &d4(),
+                                                    &d1(), &d0()};
+    return set;
+  }
+
+  // --- Core Logic ---
+  int rollFace() const {
+    if (m_multipliers.size() == 1)
+      return 1;
+    return util::rand::Random::get_int(1, getFaces());
+  }
+
+  // Applies one roll to value and returns the face that came up.
+  int roll(util::BigNumber &value) const {
+    int face = rollFace();
+    value *= m_multipliers[face - 1];
+    metrics::sim::diceRolls.inc();
+    return face;
+  }
+
+  // Combined multiplier of `rolls` independent rolls. Long batches
+  // overflow double, so the product is folded into a BigNumber every
+  // FOLD_ROLLS rolls (few enough that the partial product can't).
+  util::BigNumber rollMultiplier(std::size_t rolls) const {
+    metrics::sim::diceRolls.inc(static_cast<double>(rolls));
+    if (m_multipliers.size() == 1)
+      return pow(util::BigNumber(m_multipliers[0]),
+                 static_cast<double>(rolls));
+    auto &engine = util::rand::Random::get_engine();
+    const uint64_t faces = m_multipliers.size();
+    util::BigNumber product = 1.0;
+    double partial = 1.0;
+    for (std::size_t i = 0; i < rolls; ++i) {
+      partial *= m_multipliers[engine.bounded(faces)];
+      if ((i + 1) % FOLD_ROLLS == 0) {
+        product *= partial;
+        partial = 1.0;
+      }
+    }
+    return product * partial;
+  }
+
+  void rollBatch(util::BigNumber &value, std::size_t rolls) const {
+    value *= rollMultiplier(rolls);
+  }
+
+  // Applies `rolls` independent rolls to every object.
+  void rollBatch(std::span<EconomyObject> objects, std::size_t rolls) const {
+    for (auto &e : objects) {
+      rollBatch(e.value, rolls);
+    }
+  }
+
+  // --- Statistics ---
+  const char *getName() const { return m_name; }
+  int getFaces() const { return static_cast<int>(m_multipliers.size()); }
+  double getMultiplier(int face) const { return m_multipliers[face - 1]; }
+  const std::vector<double> &getMultipliers() const { return m_multipliers; }
+  double faceProbability() const { return 1.0 / m_multipliers.size(); }
+
+  // Expected multiplier of a single roll.
+  double expectedMultiplier() const {
+    double sum = 0.0;
+    for (double m : m_multipliers)
+      sum += m;
+    return sum * faceProbability();
+  }
+
+  // Per-roll growth rate of repeated play (log of the geometric mean); a
+  // negative value means the die shrinks the value in the long run.
+  double expectedLogMultiplier() const {
+    double sum = 0.0;
+    for (double m : m_multipliers)
+      sum += std::log(m);
+    return sum * faceProbability();
+  }
+
+private:
+  static constexpr std::size_t FOLD_ROLLS = 64;
+
+  const char *m_name;
+  std::vector<double> m_multipliers;
+};
+
+} // namespace gambling
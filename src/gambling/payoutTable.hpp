@@ -0,0 +1,163 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+namespace gambling {
+
+// Shared reel configuration. SlotMachine draws the center row from these
+// weights, so the tables below describe exactly what roll() pays out.
+namespace slots {
+constexpr int SYMBOL_COUNT = 5;
+// 0 is common, 4 is rare (Jackpot)
+constexpr int SYMBOL_WEIGHTS[SYMBOL_COUNT] = {40, 30, 15, 10, 5};
+
+constexpr double symbolProbability(int symbol) {
+  int total = 0;
+  for (int w : SYMBOL_WEIGHTS)
+    total += w;
+  return static_cast<double>(SYMBOL_WEIGHTS[symbol]) / total;
+}
+
+namespace detail {
+constexpr double ipow(double base, std::size_t exp) {
+  double r = 1.0;
+  for (std::size_t i = 0; i < exp; ++i)
+    r *= base;
+  return r;
+}
+
+// Newton iteration, good to the last bit for the small inputs used here.
+constexpr double sqrt(double v) {
+  if (v <= 0.0)
+    return 0.0;
+  double x = v > 1.0 ? v : 1.0;
+  for (int i = 0; i < 64; ++i)
+    x = 0.5 * (x + v / x);
+  return x;
+}
+} // namespace detail
+
+// Jackpot: Payout scales exponentially with the symbol's ID
+// Match three '4's: pow(5, 2.5) * 5 = ~279x multiplier
+constexpr double jackpotMultiplier(int symbol) {
+  double s = symbol + 1;
+  return s * s * detail::sqrt(s) * 5.0;
+}
+
+constexpr std::array<double, SYMBOL_COUNT> makeJackpots() {
+  std::array<double, SYMBOL_COUNT> out{};
+  for (int s = 0; s < SYMBOL_COUNT; ++s)
+    out[s] = jackpotMultiplier(s);
+  return out;
+}
+
+constexpr std::array<double, SYMBOL_COUNT> JACKPOT_MULTIPLIERS = makeJackpots();
+
+// "Near Miss" or Partial Match: Return some money to keep player engaged
+constexpr double partialMultiplier(int symbol) { return (symbol + 1) * 0.4; }
+
+// matchCount is the number of columns (including the first) whose center
+// symbol equals the first column's.
+constexpr double payoutMultiplier(int symbol, std::size_t matchCount,
+                                  std::size_t slotSize) {
+  if (matchCount == slotSize)
+    return JACKPOT_MULTIPLIERS[symbol];
+  if (matchCount >= 2)
+    return partialMultiplier(symbol);
+  return 0.0; // House wins.
+}
+
+template <std::size_t SlotSize>
+constexpr double jackpotProbability(int symbol) {
+  double p = symbolProbability(symbol);
+  return p * detail::ipow(p, SlotSize - 1);
+}
+
+template <std::size_t SlotSize>
+constexpr double partialProbability(int symbol) {
+  if constexpr (SlotSize < 3) {
+    return 0.0;
+  } else {
+    double p = symbolProbability(symbol);
+    double others = 1.0 - detail::ipow(1.0 - p, SlotSize - 1) -
+                    detail::ipow(p, SlotSize - 1);
+    return p * others;
+  }
+}
+
+template <std::size_t SlotSize> constexpr double missProbability() {
+  if constexpr (SlotSize < 2) {
+    return 0.0;
+  } else {
+    double r = 0.0;
+    for (int s = 0; s < SYMBOL_COUNT; ++s) {
+      double p = symbolProbability(s);
+      r += p * detail::ipow(1.0 - p, SlotSize - 1);
+    }
+    return r;
+  }
+}
+
+struct PayoutEntry {
+  double multiplier;
+  double probability;
+};
+
+// One miss entry, then a partial and a jackpot entry per symbol.
+constexpr std::size_t PAYOUT_ENTRY_COUNT = 1 + 2 * SYMBOL_COUNT;
+using PayoutEntries = std::array<PayoutEntry, PAYOUT_ENTRY_COUNT>;
+
+template <std::size_t SlotSize> constexpr PayoutEntries makePayoutEntries() {
+  PayoutEntries out{};
+  out[0] = {0.0, missProbability<SlotSize>()};
+  for (int s = 0; s < SYMBOL_COUNT; ++s) {
+    out[1 + 2 * s] = {partialMultiplier(s), partialProbability<SlotSize>(s)};
+    out[2 + 2 * s] = {jackpotMultiplier(s), jackpotProbability<SlotSize>(s)};
+  }
+  return out;
+}
+
+constexpr double totalProbability(const PayoutEntries &entries) {
+  double r = 0.0;
+  for (const auto &e : entries)
+    r += e.probability;
+  return r;
+}
+
+constexpr double expectedMultiplier(const PayoutEntries &entries) {
+  double r = 0.0;
+  for (const auto &e : entries)
+    r += e.multiplier * e.probability;
+  return r;
+}
+} // namespace slots
+
+// Exact center-row payout distribution of SlotMachine<SlotSize>.
+// Every column is an independent draw from slots::SYMBOL_WEIGHTS, so the
+// outcome only depends on the first symbol and how many of the remaining
+// SlotSize - 1 columns repeat it (a binomial count).
+template <std::size_t SlotSize> struct PayoutTable {
+  static_assert(SlotSize > 0, "SlotMachine needs at least one column");
+
+  static constexpr slots::PayoutEntries entries =
+      slots::makePayoutEntries<SlotSize>();
+  static constexpr const std::array<double, slots::SYMBOL_COUNT> &jackpots =
+      slots::JACKPOT_MULTIPLIERS;
+
+  // Expected payout per unit bid (return to player).
+  static constexpr double rtp = slots::expectedMultiplier(entries);
+
+  static_assert(slots::totalProbability(entries) > 1.0 - 1e-9 &&
+                    slots::totalProbability(entries) < 1.0 + 1e-9,
+                "payout probabilities must sum to 1");
+
+  static constexpr double probabilityOf(double multiplier) {
+    double r = 0.0;
+    for (const auto &e : entries)
+      if (e.multiplier == multiplier)
+        r += e.probability;
+    return r;
+  }
+};
+
+} // namespace gambling
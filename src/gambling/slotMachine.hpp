@@ -1,4 +1,6 @@
 #pragma once
+#include "gambling/payoutTable.hpp"
+#include "metrics.hpp"
 #include "utils.hpp"
 #include <algorithm>
 #include <cmath>
@@ -9,12 +11,20 @@ namespace gambling {
 
 template <std::size_t SlotSize> class SlotMachine {
 public:
+  using Payouts = PayoutTable<SlotSize>;
+  static_assert(Payouts::rtp < 1.0,
+                "SlotMachine configuration pays out more than it takes in");
+
   explicit SlotMachine(float baseBid)
-      : m_minBid(baseBid), m_cachedBid(baseBid), m_gen(std::random_device{}()) {
+      : SlotMachine(baseBid, util::rand::Random::split()) {}
+
+  // Reproducible machine for simulations that replay from a seed.
+  SlotMachine(float baseBid, util::rand::Xoshiro256 engine)
+      : m_minBid(baseBid), m_cachedBid(baseBid), m_gen(engine) {
 
     // Initialize symbols: 0 is common, 4 is rare (Jackpot)
     for (std::size_t x = 0; x < SlotSize; ++x) {
-      for (int y = 0; y < 5; ++y) {
+      for (int y = 0; y < slots::SYMBOL_COUNT; ++y) {
         m_slots[x][y] = y;
       }
       spinColumn(x);
@@ -42,33 +52,24 @@ public:
 
     // --- Payout Calculation ---
     int firstSymbol = m_slots[0][2];
-    bool allMatch = true;
-    int matchCount = 1;
+    std::size_t matchCount = 1;
 
     for (std::size_t x = 1; x < SlotSize; ++x) {
       if (m_slots[x][2] == firstSymbol) {
         matchCount++;
-      } else {
-        allMatch = false;
       }
     }
 
-    double multiplier = 0.0;
-
-    if (allMatch) {
-      // Jackpot: Payout scales exponentially with the symbol's ID
-      // Match three '4's: pow(5, 2.5) * 5 = ~279x multiplier
-      multiplier = std::pow(firstSymbol + 1, 2.5) * 5.0;
-    } else if (matchCount >= 2) {
-      // "Near Miss" or Partial Match: Return some money to keep player engaged
-      multiplier = (firstSymbol + 1) * 0.4;
-    } else {
-      // House wins.
-      multiplier = 0.0;
-    }
+    double multiplier = slots::payoutMultiplier(firstSymbol, matchCount,
+                                                SlotSize);
 
     playerBalance += static_cast<float>(m_cachedBid * multiplier);
 
+    metrics::sim::slotRolls.inc();
+    metrics::sim::slotWagered.inc(m_cachedBid);
+    metrics::sim::slotPaidOut.inc(m_cachedBid * multiplier);
+    metrics::sim::slotMultiplier.observe(multiplier);
+
     // Return the center symbol of the first column as a "rating" for the UI
     return m_slots[0][2];
   }
@@ -77,7 +78,8 @@ private:
   void spinColumn(std::size_t colIndex) {
     // Weighted Distribution: 0 and 1 are very common, 4 is very rare.
     // This ensures the "big" symbols don't hit the center row too often.
-    std::discrete_distribution<int> weightDist({40, 30, 15, 10, 5});
+    std::discrete_distribution<int> weightDist(
+        std::begin(slots::SYMBOL_WEIGHTS), std::end(slots::SYMBOL_WEIGHTS));
 
     // Rotate the column by a random amount
     std::uniform_int_distribution<int> rotDist(1, 50);
@@ -89,8 +91,8 @@ private:
 
   float m_minBid;
   float m_cachedBid;
-  std::mt19937 m_gen;
-  int m_slots[SlotSize][5];
+  util::rand::Xoshiro256 m_gen;
+  int m_slots[SlotSize][slots::SYMBOL_COUNT];
 };
 
 } // namespace gambling
@@ -0,0 +1,13 @@
+#pragma once
+#include "imgui.h"
+#include "imgui_impl_glfw.h"
+#include "imgui_impl_opengl3.h"
+namespace gui {
+// Kept apart from gui/core.hpp so the windows build without GLFW or GL.
+inline void setupFrame() {
+  ImGui_ImplOpenGL3_NewFrame();
+  ImGui_ImplGlfw_NewFrame();
+  ImGui::NewFrame();
+  ImGui::DockSpaceOverViewport(0, ImGui::GetMainViewport());
+}
+}; // namespace gui
@@ -1,6 +1,5 @@
+#pragma once
 #include "imgui.h"
-#include "imgui_impl_glfw.h"
-#include "imgui_impl_opengl3.h"
 #include <algorithm>
 #include <cstdio>
 #include <format>
@@ -26,11 +25,4 @@ inline bool buttonFormat(std::format_string<Args...> fmt, ImVec2 size,
   *res.out = '\0';
   return ImGui::Button(btnLabel, size);
 }
-
-inline void setupFrame() {
-  ImGui_ImplOpenGL3_NewFrame();
-  ImGui_ImplGlfw_NewFrame();
-  ImGui::NewFrame();
-  ImGui::DockSpaceOverViewport(0, ImGui::GetMainViewport());
-}
 }; // namespace gui
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "economy/base.hpp"
+#include "gui/core.hpp"
+#include "gui/historyPlot.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace gui {
+namespace economyList {
+
+// Economy Management list. Both views go through ImGuiListClipper, so only
+// the rows that are actually on screen get built each frame.
+class EconomyListView {
+public:
+  // Returns the object upgraded this frame, if any.
+  EconomyObject *display(std::vector<EconomyObject> &objects,
+                         double upgradeCount) {
+    upgraded = nullptr;
+    ImGui::Checkbox("Compact View", &compact);
+    if (compact) {
+      displayTable(objects, upgradeCount);
+    } else {
+      displayDetailed(objects, upgradeCount);
+    }
+    return upgraded;
+  }
+
+private:
+  enum ColumnID { NAME, VALUE, LEVEL, COST, ACTION };
+
+  // Values move every tick, so a sort on a live column is refreshed on this
+  // interval instead of every frame.
+  static constexpr double RESORT_INTERVAL = 0.5;
+
+  bool compact = false;
+  EconomyObject *upgraded = nullptr;
+  std::vector<size_t> order;
+  std::vector<historyPlot::DecimatedHistory> plotCache;
+  ImGuiID sortColumn = NAME;
+  bool sortAscending = true;
+  bool sorted = false;
+  double lastSortTime = 0.0;
+
+  void displayDetailed(std::vector<EconomyObject> &objects,
+                       double upgradeCount) {
+    plotCache.resize(objects.size());
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(objects.size()));
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+        ImGui::PushID(i);
+        detailedRow(objects[i], plotCache[i], upgradeCount);
+        ImGui::PopID();
+      }
+    }
+  }
+
+  void detailedRow(EconomyObject &e, historyPlot::DecimatedHistory &plot,
+                   double upgradeCount) {
+    EconomyObject::Number currentVal = e.value;
+    EconomyObject::Number requiredSpend =
+        e.getValueForLevelUpgrade(upgradeCount);
+    bool canAfford = currentVal >= requiredSpend;
+
+    // --- Graph Section ---
+    historyPlot::plotHistory("##History", plot, e,
+                             ImVec2(ImGui::GetContentRegionAvail().x, 120));
+
+    // --- Stats Table ---
+    if (ImGui::BeginTable("Stats", 2, ImGuiTableFlags_BordersInnerH)) {
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("Current Value:");
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%s", currentVal.format().data());
+
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("Growth Rate (LV):");
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%s / sec", e.level.format().data());
+
+      ImGui::EndTable();
+    }
+    ImGui::Spacing();
+    ImGui::SeparatorText("Formulas");
+    if (ImGui::BeginTable("##Formulas", 2, ImGuiTableFlags_BordersInnerH)) {
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("Name");
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("Formula");
+
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("Level Cost");
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%s", e.upgradeLevelFormula.getSource().c_str());
+
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("Rate Increase");
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%s", e.rateIncreaseFormula.getSource().c_str());
+      ImGui::EndTable();
+    }
+
+    ImGui::Spacing();
+    ImGui::SeparatorText("Actions");
+
+    ImGui::Spacing();
+
+    // --- Upgrade Section ---
+    // Change style for the upgrade button based on affordability
+    if (!canAfford) {
+      ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.4f, 0.1f, 0.1f, 1.0f));
+    } else {
+      ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.1f, 0.4f, 0.1f, 1.0f));
+    }
+
+    if (gui::buttonFormat("Upgrade Level (Cost: {})",
+                          ImVec2(ImGui::GetContentRegionAvail().x, 30),
+                          requiredSpend.format().data()) &&
+        canAfford && e.upgradeLevel(upgradeCount)) {
+      upgraded = &e;
+    }
+    ImGui::PopStyleColor();
+
+    // Progress bar for the next upgrade
+    float progress = static_cast<float>(
+        std::clamp((currentVal / requiredSpend).toDouble(), 0.0, 1.0));
+    ImGui::ProgressBar(progress, ImVec2(-FLT_MIN, 0),
+                       canAfford ? "READY TO UPGRADE"
+                                 : "Accumulating Funds...");
+  }
+
+  void displayTable(std::vector<EconomyObject> &objects, double upgradeCount) {
+    const ImGuiTableFlags flags =
+        ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollY |
+        ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV |
+        ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingStretchProp;
+    if (!ImGui::BeginTable("##EconomyTable", 5, flags))
+      return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_DefaultSort, 0.0f,
+                            NAME);
+    ImGui::TableSetupColumn("Value", 0, 0.0f, VALUE);
+    ImGui::TableSetupColumn("Level", 0, 0.0f, LEVEL);
+    ImGui::TableSetupColumn("Upgrade Cost", 0, 0.0f, COST);
+    ImGui::TableSetupColumn("##Action", ImGuiTableColumnFlags_NoSort, 0.0f,
+                            ACTION);
+    ImGui::TableHeadersRow();
+
+    if (ImGuiTableSortSpecs *specs = ImGui::TableGetSortSpecs()) {
+      if (specs->SpecsDirty) {
+        if (specs->SpecsCount > 0) {
+          sortColumn = specs->Specs[0].ColumnUserID;
+          sortAscending =
+              specs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+        }
+        sorted = false;
+        specs->SpecsDirty = false;
+      }
+    }
+    if (order.size() != objects.size() ||
+        (sortColumn != NAME &&
+         ImGui::GetTime() - lastSortTime > RESORT_INTERVAL)) {
+      sorted = false;
+    }
+    if (!sorted) {
+      sortRows(objects, upgradeCount);
+    }
+
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(order.size()));
+    while (clipper.Step()) {
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+        size_t i = order[row];
+        EconomyObject &e = objects[i];
+        EconomyObject::Number requiredSpend =
+            e.getValueForLevelUpgrade(upgradeCount);
+        bool canAfford = e.value >= requiredSpend;
+
+        ImGui::PushID(static_cast<int>(i));
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextUnformatted(e.name.c_str());
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%s", e.value.format().data());
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%s", e.level.format().data());
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%s", requiredSpend.format().data());
+        ImGui::TableSetColumnIndex(4);
+        ImGui::BeginDisabled(!canAfford);
+        if (ImGui::SmallButton("Upgrade") && e.upgradeLevel(upgradeCount)) {
+          upgraded = &e;
+        }
+        ImGui::EndDisabled();
+        ImGui::PopID();
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  void sortRows(const std::vector<EconomyObject> &objects,
+                double upgradeCount) {
+    order.resize(objects.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    if (sortColumn == NAME) {
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sortAscending ? objects[a].name < objects[b].name
+                             : objects[b].name < objects[a].name;
+      });
+    } else {
+      // Evaluate each key once instead of inside the comparator.
+      std::vector<EconomyObject::Number> keys(objects.size());
+      for (size_t i = 0; i < objects.size(); i++) {
+        const EconomyObject &e = objects[i];
+        if (sortColumn == VALUE)
+          keys[i] = e.value;
+        else if (sortColumn == LEVEL)
+          keys[i] = e.level;
+        else
+          keys[i] = e.getValueForLevelUpgrade(upgradeCount);
+      }
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sortAscending ? keys[a] < keys[b] : keys[b] < keys[a];
+      });
+    }
+    sorted = true;
+    lastSortTime = ImGui::GetTime();
+  }
+};
+
+}; // namespace economyList
+}; // namespace gui
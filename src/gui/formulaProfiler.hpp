@@ -0,0 +1,83 @@
+#pragma once
+
+#include "economy/base.hpp"
+#include "functionlang.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace gui {
+namespace formulaProfiler {
+
+// The expression tree of one profiled formula, one row per node, indented
+// by depth. Times are per call; rows that hit a domain guard or produced
+// NaN/inf are highlighted.
+inline void tree(const char *id, const functionlang::ExprProfile &profile) {
+  if (!ImGui::BeginTable(id, 6,
+                         ImGuiTableFlags_BordersInnerH |
+                             ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_SizingStretchProp))
+    return;
+  ImGui::TableSetupColumn("Node");
+  ImGui::TableSetupColumn("Calls");
+  ImGui::TableSetupColumn("ns/call");
+  ImGui::TableSetupColumn("Self ns");
+  ImGui::TableSetupColumn("NaN/inf");
+  ImGui::TableSetupColumn("Guards");
+  ImGui::TableHeadersRow();
+
+  const auto &nodes = profile.nodes();
+  const float indent = ImGui::GetStyle().IndentSpacing * 0.5f;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const auto &n = nodes[i];
+    double calls = static_cast<double>(std::max<uint64_t>(n.calls, 1));
+    ImGui::TableNextRow();
+    ImGui::TableSetColumnIndex(0);
+    if (n.depth > 0)
+      ImGui::Indent(n.depth * indent);
+    if (n.guardHits || n.nonFinite)
+      ImGui::TextColored(ImVec4(1.0f, 0.7f, 0.2f, 1.0f), "%s",
+                         n.source.c_str());
+    else
+      ImGui::TextUnformatted(n.source.c_str());
+    ImGui::SetItemTooltip("%s", functionlang::ExprProfile::opName(n.op));
+    if (n.depth > 0)
+      ImGui::Unindent(n.depth * indent);
+    ImGui::TableSetColumnIndex(1);
+    ImGui::Text("%llu", (unsigned long long)n.calls);
+    ImGui::TableSetColumnIndex(2);
+    ImGui::Text("%.1f", n.nanos / calls);
+    ImGui::TableSetColumnIndex(3);
+    ImGui::Text("%.1f", profile.selfNanos(i) / calls);
+    ImGui::TableSetColumnIndex(4);
+    ImGui::Text("%llu", (unsigned long long)n.nonFinite);
+    ImGui::TableSetColumnIndex(5);
+    ImGui::Text("%llu", (unsigned long long)n.guardHits);
+  }
+  ImGui::EndTable();
+}
+
+// Profiling switch and annotated trees for both of an object's formulas.
+inline void display(EconomyObject &e) {
+  bool profiling = e.upgradeLevelFormula.isProfiling();
+  if (ImGui::Checkbox("Profile Formulas", &profiling)) {
+    e.upgradeLevelFormula.setProfiling(profiling);
+    e.rateIncreaseFormula.setProfiling(profiling);
+  }
+  if (!profiling) {
+    ImGui::TextDisabled("Compiled without instrumentation");
+    return;
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Reset Counters")) {
+    e.upgradeLevelFormula.resetProfile();
+    e.rateIncreaseFormula.resetProfile();
+  }
+  ImGui::SeparatorText("Level Cost");
+  tree("##LevelCost", *e.upgradeLevelFormula.getProfile());
+  ImGui::SeparatorText("Rate Increase");
+  tree("##RateIncrease", *e.rateIncreaseFormula.getProfile());
+}
+
+}; // namespace formulaProfiler
+}; // namespace gui
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "economy/base.hpp"
+#include "imgui.h"
+#include "persistent.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace gui {
+namespace historyPlot {
+
+// Reduces a sliding history window to at most one min/max pair per
+// horizontal pixel. Buckets are aligned to absolute sample numbers, so a new
+// sample only touches the newest bucket (and rescans the partially expired
+// oldest one); extremes are kept exactly, so spikes never disappear.
+class DecimatedHistory {
+public:
+  using Number = EconomyObject::Number;
+
+  // history holds the last history.size() of sampleCount samples.
+  void sync(const persistent::Ring<Number> &history, uint64_t sampleCount,
+            int pixelWidth) {
+    size_t length = history.size();
+    size_t width = static_cast<size_t>(std::max(pixelWidth, 1));
+    size_t bucketSize = std::max<size_t>(1, (length + width - 1) / width);
+
+    if (bucketSize != m_bucketSize || length != m_length ||
+        sampleCount < m_sampleCount ||
+        sampleCount - m_sampleCount >= length) {
+      rebuild(history, sampleCount, bucketSize);
+      return;
+    }
+    if (sampleCount == m_sampleCount)
+      return;
+
+    for (uint64_t abs = m_sampleCount; abs < sampleCount; ++abs) {
+      append(abs, history[abs + length - sampleCount]);
+    }
+    m_sampleCount = sampleCount;
+    expire(history);
+    m_dirty = true;
+  }
+
+  // Interleaved extremes in the order they occurred, ready for PlotLines.
+  // Values past float range are divided by a common power of two first;
+  // scaled() applies the same factor to the plot's bounds.
+  const std::vector<float> &points() {
+    if (m_dirty) {
+      int64_t top = 0;
+      for (const Bucket &b : m_buckets) {
+        top = std::max({top, abs(b.min).exponent(), abs(b.max).exponent()});
+      }
+      m_scale = Number::fromParts(1.0, -std::max<int64_t>(0, top - 64));
+      m_points.clear();
+      for (const Bucket &b : m_buckets) {
+        if (b.minFirst) {
+          m_points.push_back(scaled(b.min));
+          m_points.push_back(scaled(b.max));
+        } else {
+          m_points.push_back(scaled(b.max));
+          m_points.push_back(scaled(b.min));
+        }
+      }
+      m_dirty = false;
+    }
+    return m_points;
+  }
+
+  float scaled(Number v) const {
+    return static_cast<float>((v * m_scale).toDouble());
+  }
+
+  std::string owner;
+
+private:
+  struct Bucket {
+    uint64_t key;
+    Number min;
+    Number max;
+    bool minFirst;
+  };
+
+  void rebuild(const persistent::Ring<Number> &history, uint64_t sampleCount,
+               size_t bucketSize) {
+    m_buckets.clear();
+    m_bucketSize = bucketSize;
+    m_length = history.size();
+    m_sampleCount = sampleCount;
+    uint64_t first = sampleCount - std::min<uint64_t>(sampleCount, m_length);
+    size_t offset = m_length - (sampleCount - first);
+    for (uint64_t abs = first; abs < sampleCount; ++abs) {
+      append(abs, history[offset + (abs - first)]);
+    }
+    m_dirty = true;
+  }
+
+  void append(uint64_t abs, Number v) {
+    uint64_t key = abs / m_bucketSize;
+    if (m_buckets.empty() || m_buckets.back().key != key) {
+      m_buckets.push_back({key, v, v, true});
+      return;
+    }
+    Bucket &b = m_buckets.back();
+    if (v < b.min) {
+      b.min = v;
+      b.minFirst = false;
+    }
+    if (v > b.max) {
+      b.max = v;
+      b.minFirst = true;
+    }
+  }
+
+  // Drops buckets that slid out of the window and rescans the oldest one if
+  // only part of it is still visible.
+  void expire(const persistent::Ring<Number> &history) {
+    uint64_t first =
+        m_sampleCount - std::min<uint64_t>(m_sampleCount, m_length);
+    uint64_t firstKey = first / m_bucketSize;
+    while (!m_buckets.empty() && m_buckets.front().key < firstKey) {
+      m_buckets.pop_front();
+    }
+    if (m_buckets.empty() || first % m_bucketSize == 0)
+      return;
+
+    Bucket &b = m_buckets.front();
+    uint64_t end = std::min<uint64_t>((firstKey + 1) * m_bucketSize,
+                                      m_sampleCount);
+    size_t offset = m_length - (m_sampleCount - first);
+    b = {firstKey, history[offset], history[offset], true};
+    for (uint64_t abs = first + 1; abs < end; ++abs) {
+      Number v = history[offset + (abs - first)];
+      if (v < b.min) {
+        b.min = v;
+        b.minFirst = false;
+      }
+      if (v > b.max) {
+        b.max = v;
+        b.minFirst = true;
+      }
+    }
+  }
+
+  std::deque<Bucket> m_buckets;
+  std::vector<float> m_points;
+  Number m_scale = Number(1.0);
+  size_t m_bucketSize = 0;
+  size_t m_length = 0;
+  uint64_t m_sampleCount = 0;
+  bool m_dirty = true;
+};
+
+// PlotLines over the decimated history; cost scales with the widget width
+// rather than the history length.
+inline void plotHistory(const char *label, DecimatedHistory &cache,
+                        const EconomyObject &e, ImVec2 size) {
+  if (cache.owner != e.uuid) {
+    cache = DecimatedHistory();
+    cache.owner = e.uuid;
+  }
+  cache.sync(e.history, e.historySamples, static_cast<int>(size.x));
+  const std::vector<float> &points = cache.points();
+  ImGui::PlotLines(label, points.data(), static_cast<int>(points.size()), 0,
+                   e.name.c_str(), cache.scaled(e.minValue),
+                   cache.scaled(e.maxValue), size);
+}
+
+}; // namespace historyPlot
+}; // namespace gui
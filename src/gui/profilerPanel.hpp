@@ -0,0 +1,121 @@
+#pragma once
+
+#include "imgui.h"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace gui {
+namespace profilerPanel {
+
+inline ImU32 zoneColor(const char *name) {
+  size_t h = std::hash<const void *>{}(name);
+  float hue = static_cast<float>(h % 1000) / 1000.0f;
+  return ImColor::HSV(hue, 0.55f, 0.75f);
+}
+
+// Flame graph of the last completed frame: one lane per thread, nested zones
+// stacked below their parents.
+inline void timeline(const profiler::FrameProfiler &fp) {
+  const auto &zones = fp.lastFrame();
+  uint64_t start = fp.lastFrameStart();
+  uint64_t end = fp.lastFrameEnd();
+  if (end <= start) {
+    ImGui::TextDisabled("No frame captured yet");
+    return;
+  }
+
+  std::map<uint32_t, uint32_t> laneDepth;
+  for (const auto &z : zones)
+    laneDepth[z.thread] = std::max(laneDepth[z.thread], z.depth + 1);
+  std::map<uint32_t, uint32_t> laneOffset;
+  uint32_t rows = 0;
+  for (auto &[thread, depth] : laneDepth) {
+    laneOffset[thread] = rows;
+    rows += depth;
+  }
+
+  const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+  const float width = ImGui::GetContentRegionAvail().x;
+  const float height = std::max(rows, 1u) * rowHeight;
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  const double span = static_cast<double>(end - start);
+  ImDrawList *drawList = ImGui::GetWindowDrawList();
+
+  drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height),
+                          IM_COL32(30, 30, 30, 255));
+  for (const auto &z : zones) {
+    uint64_t zs = std::max(z.start, start);
+    uint64_t ze = std::min(z.end, end);
+    if (ze <= zs)
+      continue;
+    float x0 = origin.x + static_cast<float>((zs - start) / span * width);
+    float x1 = origin.x + static_cast<float>((ze - start) / span * width);
+    x1 = std::max(x1, x0 + 1.0f);
+    float y0 = origin.y + (laneOffset[z.thread] + z.depth) * rowHeight;
+    ImVec2 a(x0, y0), b(x1, y0 + rowHeight - 1.0f);
+
+    drawList->AddRectFilled(a, b, zoneColor(z.name));
+    if (ImGui::CalcTextSize(z.name).x < x1 - x0 - 4.0f)
+      drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32_WHITE, z.name);
+    if (ImGui::IsMouseHoveringRect(a, b))
+      ImGui::SetTooltip("%s\n%.3f ms (thread %u)", z.name,
+                        (z.end - z.start) / 1e6, z.thread);
+  }
+  ImGui::Dummy(ImVec2(width, height));
+}
+
+inline void display() {
+  auto &fp = profiler::FrameProfiler::get();
+  static std::string exportStatus;
+
+#ifdef SIMULASI_DISABLE_PROFILER
+  ImGui::TextDisabled("Profiler compiled out (SIMULASI_DISABLE_PROFILER)");
+#endif
+  ImGui::Checkbox("Pause Capture", &fp.paused);
+  ImGui::SameLine();
+  if (ImGui::Button("Export Chrome Trace")) {
+    exportStatus = profiler::exportChromeTrace("trace.json")
+                       ? "Wrote trace.json"
+                       : "Could not write trace.json";
+  }
+  if (!exportStatus.empty()) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted(exportStatus.c_str());
+  }
+  ImGui::Text("Frame: %.3f ms",
+              (fp.lastFrameEnd() - fp.lastFrameStart()) / 1e6);
+
+  timeline(fp);
+
+  if (ImGui::BeginTable("##ProfilerStats", 5,
+                        ImGuiTableFlags_BordersInnerH |
+                            ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Zone");
+    ImGui::TableSetupColumn("Last (ms)");
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableHeadersRow();
+    for (const auto &[name, stats] : fp.stats()) {
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::TextUnformatted(name);
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%.3f", stats.last);
+      ImGui::TableSetColumnIndex(2);
+      ImGui::Text("%.3f", stats.percentile(0.50));
+      ImGui::TableSetColumnIndex(3);
+      ImGui::Text("%.3f", stats.percentile(0.95));
+      ImGui::TableSetColumnIndex(4);
+      ImGui::Text("%.3f", stats.percentile(0.99));
+    }
+    ImGui::EndTable();
+  }
+}
+
+}; // namespace profilerPanel
+}; // namespace gui
@@ -2,57 +2,168 @@
 
 #include "economy/base.hpp"
 #include "imgui.h"
+#include <algorithm>
+#include <cctype>
 #include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
 namespace gui {
 namespace selectionMenu {
+
+// Lower-cased copy used for case-insensitive matching.
+inline std::string foldCase(const std::string &s) {
+  std::string out(s);
+  for (auto &c : out)
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return out;
+}
+
+// 0 = prefix, 1 = substring, 2 = subsequence (fuzzy), -1 = no match.
+inline int matchRank(const std::string &name, const std::string &query) {
+  if (query.empty() || name.starts_with(query))
+    return 0;
+  if (name.find(query) != std::string::npos)
+    return 1;
+  size_t q = 0;
+  for (char c : name) {
+    if (c == query[q] && ++q == query.size())
+      return 2;
+  }
+  return -1;
+}
+
 template <typename T> class ISelectionMenu {
 protected:
   std::vector<T> *selectionRef;
-  std::vector<const char *> selectionNames;
+  // Name index, rebuilt incrementally as the collection grows.
+  std::vector<std::string> selectionNames;
+  std::vector<std::string> foldedNames;
+  std::vector<std::string> selectionKeys;
   size_t selectionIndex;
   const char *noSelectionText;
 
-  virtual std::string getPreviewName() {
+  // Search state. matches holds indices into selectionRef, best rank first.
+  char query[128] = "";
+  std::string lastQuery;
+  std::vector<size_t> matches;
+  bool matchesValid = false;
 
-    if (selectionRef->empty())
+  virtual std::string getPreviewName() {
+    if (!selectionRef || selectionRef->empty())
       return noSelectionText;
-    else if (selectionIndex < selectionRef->capacity())
+    else if (selectionIndex < selectionNames.size())
       return selectionNames[selectionIndex];
 
     return noSelectionText;
   }
   virtual std::string getItemName(size_t index) = 0;
 
+  // Identity used to notice a replaced collection; defaults to the name.
+  virtual std::string getItemKey(size_t index) { return getItemName(index); }
+
+  bool isStale(size_t index) {
+    return selectionKeys[index] != getItemKey(index);
+  }
+
+  void syncIndex() {
+    size_t size = selectionRef ? selectionRef->size() : 0;
+    size_t cached = selectionNames.size();
+    if (size < cached ||
+        (cached > 0 && (isStale(0) || isStale(cached - 1)))) {
+      invalidate();
+      cached = 0;
+    }
+    if (selectionIndex >= size)
+      selectionIndex = 0;
+    if (size == cached)
+      return;
+    for (size_t n = cached; n < size; n++) {
+      selectionNames.push_back(getItemName(n));
+      selectionKeys.push_back(getItemKey(n));
+      foldedNames.push_back(foldCase(selectionNames.back()));
+    }
+    matchesValid = false;
+  }
+
+  void updateMatches() {
+    std::string folded = foldCase(query);
+    std::vector<std::pair<int, size_t>> ranked;
+
+    if (matchesValid && folded == lastQuery)
+      return;
+
+    // A longer query can only narrow the previous result set.
+    if (matchesValid && folded.starts_with(lastQuery)) {
+      for (size_t n : matches) {
+        int rank = matchRank(foldedNames[n], folded);
+        if (rank >= 0)
+          ranked.emplace_back(rank, n);
+      }
+    } else {
+      for (size_t n = 0; n < foldedNames.size(); n++) {
+        int rank = matchRank(foldedNames[n], folded);
+        if (rank >= 0)
+          ranked.emplace_back(rank, n);
+      }
+    }
+    std::stable_sort(ranked.begin(), ranked.end());
+
+    matches.clear();
+    for (auto &[rank, n] : ranked)
+      matches.push_back(n);
+    lastQuery = std::move(folded);
+    matchesValid = true;
+  }
+
 public:
   ISelectionMenu(std::vector<T> *toSelect, const char *noSelectionText = "None")
       : selectionRef(toSelect), selectionIndex(0),
         noSelectionText(noSelectionText) {}
   virtual ~ISelectionMenu() = default;
 
+  // Forces a full rebuild of the name index on the next display().
+  void invalidate() {
+    selectionNames.clear();
+    foldedNames.clear();
+    selectionKeys.clear();
+    matchesValid = false;
+  }
+
   void display(const char *label = "Select") {
+    syncIndex();
     std::string preview = getPreviewName();
 
-    if (ImGui::BeginCombo(label, preview.c_str())) {
-      for (size_t n = 0; n < selectionRef->size(); n++) {
-        const bool isSelected = (selectionIndex == n);
+    if (ImGui::BeginCombo(label, preview.c_str(),
+                          ImGuiComboFlags_HeightLarge)) {
+      if (ImGui::IsWindowAppearing())
+        ImGui::SetKeyboardFocusHere();
+      ImGui::InputTextWithHint("##Search", "Search...", query,
+                               IM_ARRAYSIZE(query));
+      updateMatches();
 
-        // We call getItemName(n) here so every row gets its own name
-        std::string name = getItemName(n);
+      ImGuiListClipper clipper;
+      clipper.Begin(static_cast<int>(matches.size()));
+      while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+          size_t n = matches[row];
+          const bool isSelected = (selectionIndex == n);
 
-        if (ImGui::Selectable(name.c_str(), isSelected)) {
-          selectionIndex = n;
-        }
+          ImGui::PushID(static_cast<int>(n));
+          if (ImGui::Selectable(selectionNames[n].c_str(), isSelected)) {
+            selectionIndex = n;
+          }
+          ImGui::PopID();
 
-        if (isSelected)
-          ImGui::SetItemDefaultFocus();
+          if (isSelected)
+            ImGui::SetItemDefaultFocus();
+        }
       }
       ImGui::EndCombo();
     }
   }
 
-  T &getSelectedItem() { return selectionRef[selectionIndex]; };
+  T &getSelectedItem() { return (*selectionRef)[selectionIndex]; };
   size_t getIndex() { return selectionIndex; }
 };
 
@@ -62,20 +173,13 @@ public: // Made public so you can actually instantiate it!
                              const char *noSelectionText = "None")
       : ISelectionMenu<EconomyObject>(toSelect, noSelectionText) {}
 
-  std::string getPreviewName() override {
-    if (!selectionRef || selectionRef->empty())
-      return noSelectionText;
-
-    // Use .size() rather than .capacity() for bounds checking
-    if (selectionIndex < selectionRef->size()) {
-      return (*selectionRef)[selectionIndex].name; // Assuming getName() exists
-    }
-    return noSelectionText;
-  }
-
   std::string getItemName(size_t index) override {
     return (*selectionRef)[index].name;
   }
+
+  std::string getItemKey(size_t index) override {
+    return (*selectionRef)[index].uuid;
+  }
 };
 }; // namespace selectionMenu
 }; // namespace gui
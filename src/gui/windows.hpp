@@ -0,0 +1,229 @@
+#pragma once
+
+#include "economy/base.hpp"
+#include "economy/economy.hpp"
+#include "economy/journal.hpp"
+#include "economy/timeline.hpp"
+#include "gambling/dice.hpp"
+#include "gui/core.hpp"
+#include "gui/economyList.hpp"
+#include "gui/formulaProfiler.hpp"
+#include "gui/profilerPanel.hpp"
+#include "gui/selectionMenu.hpp"
+#include "imgui.h"
+#include "persistent.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+namespace gui {
+namespace windows {
+
+// The game's windows, built from an Economy and the UI state below only, so
+// they run the same under main.cpp's GLFW/OpenGL loop as against a bare
+// ImGui context (headless-ui.out). Anything tied to the platform window is
+// left to the caller.
+struct State {
+  explicit State(Economy &economy)
+      : economySelect(&economy.economySystem),
+        profileSelect(&economy.economySystem) {}
+
+  selectionMenu::EconomyObjectSelectionMenu economySelect;
+  selectionMenu::EconomyObjectSelectionMenu profileSelect;
+  economyList::EconomyListView economyList;
+  // Journals upgrades and gambles as they happen, when set.
+  journal::Autosave *autosave = nullptr;
+  double upgradeCount = 1.0;
+  int diceRolls = 1;
+  int traderSpawn = 1000;
+  int timelineIndex = 0;
+  bool scrubbing = false;
+};
+
+// Returns true when Quit was pressed.
+inline bool mainMenu() {
+  PROFILE_SCOPE("Main Menu UI");
+  ImGui::Begin("Main Menu");
+  ImGui::SeparatorText("General");
+  bool quit = ImGui::Button("Quit");
+  ImGui::End();
+  return quit;
+}
+
+inline void economyManagement(Economy &economy, State &state) {
+  PROFILE_SCOPE("Economy Management UI");
+  ImGui::Begin("Economy Management", nullptr, ImGuiWindowFlags_NoCollapse);
+  // --- Header Section ---
+  ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "Market Status");
+  {
+    const auto &objects = economy.economySystem;
+    const auto &market = economy.aggregates;
+    ImGui::Text("Total value: %s | Index: %s", market.total().format().data(),
+                market.index().format().data());
+    ImGui::Text("Value p10 %s | p50 %s | p90 %s | p99 %s",
+                market.percentile(0.10).format().data(),
+                market.percentile(0.50).format().data(),
+                market.percentile(0.90).format().data(),
+                market.percentile(0.99).format().data());
+    for (const auto &mover : market.topMovers(objects, 3)) {
+      ImGui::SameLine();
+      ImGui::Text("%s %+.1f%%", objects[mover.object].name.c_str(),
+                  mover.change * 100.0);
+    }
+  }
+  ImGui::Separator();
+
+  ImGui::BeginChild("##Economy Management",
+                    ImVec2(ImGui::GetWindowSize().x, 600.0));
+  gui::doubleInput(state.upgradeCount, 0.1, 10.0, "Level Upgrade Count");
+  EconomyObject *upgraded =
+      state.economyList.display(economy.economySystem, state.upgradeCount);
+  if (upgraded && state.autosave)
+    state.autosave->upgraded(economy, *upgraded, state.upgradeCount);
+  ImGui::EndChild();
+
+  ImGui::End();
+}
+
+inline void gambling(Economy &economy, State &state) {
+  PROFILE_SCOPE("Gambling UI");
+  ImGui::Begin("Gambling");
+  auto &items = economy.economySystem;
+  state.economySelect.display();
+  size_t selected = state.economySelect.getIndex();
+  if (selected < items.size()) {
+    ImGui::InputInt("Rolls", &state.diceRolls);
+    state.diceRolls = std::max(state.diceRolls, 1);
+    bool first = true;
+    for (const ::gambling::Dice *die : ::gambling::Dice::standardSet()) {
+      if (!first)
+        ImGui::SameLine();
+      first = false;
+      if (ImGui::Button(die->getName())) {
+        die->rollBatch(items[selected].value, state.diceRolls);
+        if (state.autosave)
+          state.autosave->gambled(economy, items[selected], die->getName(),
+                                  state.diceRolls);
+      }
+      ImGui::SetItemTooltip("E[x] = %.4f, growth/roll = %.4f",
+                            die->expectedMultiplier(),
+                            die->expectedLogMultiplier());
+    }
+
+    // Costs one upgrade; a d20 decides how much extra level (face/10 of
+    // the current one) the object gets for the next 30 seconds.
+    EconomyObject &target = items[selected];
+    EconomyObject::Number boostCost = target.getValueForLevelUpgrade();
+    ImGui::BeginDisabled(target.value < boostCost);
+    if (ImGui::Button("Roll for Boost")) {
+      target.value -= boostCost;
+      int face = ::gambling::Dice::d20().rollFace();
+      economy.boostLevel(target, target.level * (face / 10.0), 30.0);
+      if (state.autosave)
+        state.autosave->gambled(economy, target, "d20 boost", 1);
+    }
+    ImGui::EndDisabled();
+    ImGui::SetItemTooltip("Cost %s, %zu timed events pending",
+                          boostCost.format().data(),
+                          economy.scheduler.pending());
+  }
+
+  ImGui::End();
+}
+
+// `hostSettings` draws the platform-specific controls (window title,
+// background colour, metrics endpoint) under the Debug heading.
+inline void debug(Economy &economy, Timeline &timeline, State &state,
+                  float deltaTime,
+                  const std::function<void()> &hostSettings = nullptr) {
+  PROFILE_SCOPE("Debug UI");
+  ImGui::Begin("Debug");
+  ImGui::SeparatorText("Debug");
+  ImGui::Text("dt: %.2f", 1.0f / deltaTime);
+  if (ImGui::Button("Reset Economy")) {
+    economy = Economy();
+  }
+  if (hostSettings)
+    hostSettings();
+  if (ImGui::CollapsingHeader("Profiler")) {
+    gui::profilerPanel::display();
+  }
+  if (ImGui::CollapsingHeader("Formula Profiler")) {
+    state.profileSelect.display("Object");
+    size_t selected = state.profileSelect.getIndex();
+    if (selected < economy.economySystem.size())
+      gui::formulaProfiler::display(economy.economySystem[selected]);
+  }
+  if (ImGui::CollapsingHeader("Timeline")) {
+    ImGui::Text("%zu snapshots, %.1f / %.0f MB", timeline.size(),
+                timeline.bytes() / 1048576.0,
+                timeline.budget / 1048576.0);
+    // Follows the newest snapshot until grabbed; letting go rewinds.
+    int last = static_cast<int>(timeline.size()) - 1;
+    if (!state.scrubbing)
+      state.timelineIndex = last;
+    if (last >= 0) {
+      state.timelineIndex = std::clamp(state.timelineIndex, 0, last);
+      char label[32];
+      std::snprintf(label, sizeof(label), "%.0f s ago",
+                    timeline.now() - timeline[state.timelineIndex].time);
+      ImGui::SliderInt("Rewind", &state.timelineIndex, 0, last, label);
+      state.scrubbing = ImGui::IsItemActive();
+      if (ImGui::IsItemDeactivatedAfterEdit()) {
+        timeline.restore(static_cast<size_t>(state.timelineIndex), economy);
+      }
+    }
+  }
+  if (state.autosave && ImGui::CollapsingHeader("Autosave")) {
+    journal::Stats s = state.autosave->stats();
+    ImGui::Text("%llu records, %llu commits, %llu checkpoints",
+                (unsigned long long)s.records, (unsigned long long)s.commits,
+                (unsigned long long)s.checkpoints);
+    ImGui::Text("Journal %.1f KB, last commit %.2f ms",
+                s.journalBytes / 1024.0, s.lastCommitSeconds * 1000.0);
+    if (state.autosave->hasFailed())
+      ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f),
+                         "Writing the save failed");
+  }
+  if (ImGui::CollapsingHeader("Traders")) {
+    auto &traders = economy.traders;
+    ImGui::SetNextItemWidth(120);
+    ImGui::InputInt("##TraderSpawn", &state.traderSpawn);
+    state.traderSpawn = std::max(state.traderSpawn, 1);
+    ImGui::SameLine();
+    if (ImGui::Button("Spawn Traders")) {
+      traders.spawn(static_cast<size_t>(state.traderSpawn));
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Remove All")) {
+      traders.clear(economy.stocks);
+    }
+    ImGui::Text("%zu agents, %u workers", traders.size(), traders.workers);
+    const auto &a = traders.lastActions;
+    ImGui::Text("Last tick: %llu hold, %llu upgrade, %llu gamble, "
+                "%llu buy, %llu sell",
+                (unsigned long long)a[0], (unsigned long long)a[1],
+                (unsigned long long)a[2], (unsigned long long)a[3],
+                (unsigned long long)a[4]);
+    for (const auto &stock : economy.stocks) {
+      // An empty side shows "-" rather than NO_PRICE in ticks.
+      char bid[32] = "-", ask[32] = "-";
+      if (stock.book.bestBid() != market::OrderBook::NO_PRICE)
+        std::snprintf(bid, sizeof(bid), "%.2f",
+                      stock.fromTicks(stock.book.bestBid()));
+      if (stock.book.bestAsk() != market::OrderBook::NO_PRICE)
+        std::snprintf(ask, sizeof(ask), "%.2f",
+                      stock.fromTicks(stock.book.bestAsk()));
+      ImGui::Text("%s: %s (bid %s / ask %s, %zu resting)", stock.name.c_str(),
+                  stock.value.format().data(), bid, ask,
+                  stock.book.orderCount());
+    }
+  }
+  ImGui::SeparatorText("Economy Objects");
+
+  ImGui::End();
+}
+
+}; // namespace windows
+}; // namespace gui
@@ -0,0 +1,932 @@
+// Headless runner: exercises the simulation without a window or GL context.
+// Usage: headless.out <mode> [args...]
+#include "economy/economy.hpp"
+#include "economy/journal.hpp"
+#include "economy/orderBook.hpp"
+#include "economy/shards.hpp"
+#include "economy/timeline.hpp"
+#include "economy/timerWheel.hpp"
+#include "bigNumber.hpp"
+#include "gambling/dice.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace bench {
+using Clock = std::chrono::steady_clock;
+
+template <typename F> double secondsFor(F &&f) {
+  auto start = Clock::now();
+  f();
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// CPU time of the calling thread: leaves out the time it sat preempted
+// while other threads had the cores.
+double threadSeconds() {
+  timespec now;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return static_cast<double>(now.tv_sec) + now.tv_nsec * 1e-9;
+}
+
+void report(const std::string &name, size_t ops, double seconds) {
+  std::cout << "  " << name << ": " << ops / seconds / 1e6 << " M/s ("
+            << seconds * 1e9 / ops << " ns/op)" << std::endl;
+}
+
+size_t argOr(const std::vector<std::string> &args, size_t i, size_t fallback) {
+  return i < args.size() ? std::stoull(args[i]) : fallback;
+}
+
+// rng [draws]: util::rand against the std::mt19937 + distribution it replaced.
+int rng(const std::vector<std::string> &args) {
+  const size_t n = argOr(args, 0, 50'000'000);
+  volatile int64_t sink = 0;
+  int64_t acc = 0;
+
+  std::cout << "rng (" << n << " draws)" << std::endl;
+
+  std::mt19937 mt(12345);
+  report("mt19937 + uniform_int_distribution(1, 20)", n, secondsFor([&] {
+           for (size_t i = 0; i < n; ++i) {
+             std::uniform_int_distribution<int> dist(1, 20);
+             acc += dist(mt);
+           }
+         }));
+  report("Random::get_int(1, 20)", n, secondsFor([&] {
+           for (size_t i = 0; i < n; ++i)
+             acc += util::rand::Random::get_int(1, 20);
+         }));
+
+  double facc = 0.0;
+  report("mt19937 + uniform_real_distribution<double>", n, secondsFor([&] {
+           for (size_t i = 0; i < n; ++i) {
+             std::uniform_real_distribution<double> dist(0.0, 1.0);
+             facc += dist(mt);
+           }
+         }));
+  report("Random::get_double()", n, secondsFor([&] {
+           for (size_t i = 0; i < n; ++i)
+             facc += util::rand::Random::get_double();
+         }));
+
+  std::vector<int> ints(n);
+  std::vector<double> doubles(n);
+  report("Random::fill_int(1, 20)", n, secondsFor([&] {
+           util::rand::Random::fill_int(ints, 1, 20);
+         }));
+  report("Random::fill_double()", n, secondsFor([&] {
+           util::rand::Random::fill_double(doubles);
+         }));
+
+  sink = acc + static_cast<int64_t>(facc) + ints[n / 2] +
+         static_cast<int64_t>(doubles[n / 2]);
+  (void)sink;
+  return 0;
+}
+
+// The obvious order book, to check market::OrderBook against: FIFO queues
+// in a std::map per side. Resting orders take the ids the real book handed
+// out, and prints leave the owners at 0 as the benchmark does.
+class ReferenceBook {
+public:
+  using Side = market::Side;
+  static constexpr uint64_t NO_ORDER = market::OrderBook::NO_ORDER;
+
+  uint32_t match(Side side, int64_t price, uint32_t quantity) {
+    return side == Side::Buy ? take(asks, side, price, quantity)
+                             : take(bids, side, price, quantity);
+  }
+
+  void rest(Side side, int64_t price, uint32_t quantity, uint64_t id) {
+    if (side == Side::Buy)
+      bids[price].push_back({id, quantity});
+    else
+      asks[price].push_back({id, quantity});
+    where[id] = {side, price};
+  }
+
+  bool cancel(uint64_t id) {
+    auto it = where.find(id);
+    if (it == where.end())
+      return false;
+    auto [side, price] = it->second;
+    where.erase(it);
+    if (side == Side::Buy)
+      remove(bids, price, id);
+    else
+      remove(asks, price, id);
+    return true;
+  }
+
+  int64_t bestBid() const {
+    return bids.empty() ? market::OrderBook::NO_PRICE : bids.begin()->first;
+  }
+  int64_t bestAsk() const {
+    return asks.empty() ? market::OrderBook::NO_PRICE : asks.begin()->first;
+  }
+  size_t orderCount() const { return where.size(); }
+
+  std::vector<market::Trade> prints;
+
+private:
+  struct Resting {
+    uint64_t id;
+    uint32_t quantity;
+  };
+
+  template <typename Levels>
+  uint32_t take(Levels &levels, Side side, int64_t price, uint32_t quantity) {
+    bool buying = side == Side::Buy;
+    while (quantity > 0 && !levels.empty()) {
+      auto level = levels.begin();
+      if (buying ? level->first > price : level->first < price)
+        break;
+      auto &queue = level->second;
+      while (quantity > 0 && !queue.empty()) {
+        Resting &o = queue.front();
+        uint32_t fill = std::min(quantity, o.quantity);
+        prints.push_back({buying ? NO_ORDER : o.id, buying ? o.id : NO_ORDER,
+                          0, 0, level->first, fill, side});
+        quantity -= fill;
+        o.quantity -= fill;
+        if (o.quantity == 0) {
+          where.erase(o.id);
+          queue.pop_front();
+        }
+      }
+      if (queue.empty())
+        levels.erase(level);
+    }
+    return quantity;
+  }
+
+  template <typename Levels>
+  static void remove(Levels &levels, int64_t price, uint64_t id) {
+    auto &queue = levels.at(price);
+    queue.erase(std::find_if(queue.begin(), queue.end(),
+                             [&](const Resting &o) { return o.id == id; }));
+    if (queue.empty())
+      levels.erase(price);
+  }
+
+  std::map<int64_t, std::deque<Resting>, std::greater<>> bids;
+  std::map<int64_t, std::deque<Resting>> asks;
+  std::unordered_map<uint64_t, std::pair<Side, int64_t>> where;
+};
+
+// orderbook [ops]: synthetic flow against one market::OrderBook. 55% limit
+// orders around a random-walking mid, 30% cancels of live orders, 15%
+// market orders. Random draws are generated up front so only the book is
+// timed. The first 200k operations are then replayed against a
+// ReferenceBook, comparing every print, the touch and the resting count.
+int orderbook(const std::vector<std::string> &args) {
+  const size_t n = argOr(args, 0, 10'000'000);
+  using market::OrderBook;
+  using market::Side;
+
+  struct Op {
+    uint8_t kind;
+    Side side;
+    int32_t offset;
+    uint32_t quantity;
+    uint32_t pick;
+  };
+  std::vector<Op> ops(n);
+  auto &rng = util::rand::Random::get_engine();
+  for (auto &op : ops) {
+    uint64_t r = rng.bounded(100);
+    op.kind = r < 55 ? 0 : r < 85 ? 1 : 2;
+    op.side = rng.bounded(2) ? Side::Buy : Side::Sell;
+    op.offset = static_cast<int32_t>(rng.bounded(41)) - 20;
+    op.quantity = 1 + static_cast<uint32_t>(rng.bounded(100));
+    op.pick = static_cast<uint32_t>(rng());
+  }
+
+  // Buyers quote below mid and sellers above, with some crossing.
+  auto quote = [](const Op &op, int64_t mid) {
+    return mid +
+           (op.side == Side::Buy ? -op.offset / 2 - 5 : op.offset / 2 + 5) +
+           op.offset / 4;
+  };
+
+  OrderBook book;
+  std::vector<OrderBook::OrderId> live;
+  live.reserve(1 << 20);
+  int64_t mid = 2000;
+  size_t trades = 0;
+
+  double seconds = secondsFor([&] {
+    for (const Op &op : ops) {
+      switch (op.kind) {
+      case 0: {
+        auto id = book.limit(op.side, quote(op, mid), op.quantity);
+        if (id != OrderBook::NO_ORDER)
+          live.push_back(id);
+        break;
+      }
+      case 1:
+        if (!live.empty()) {
+          size_t k = op.pick % live.size();
+          book.cancel(live[k]);
+          live[k] = live.back();
+          live.pop_back();
+        }
+        break;
+      default:
+        book.market(op.side, op.quantity);
+        break;
+      }
+      if (!book.trades().empty()) {
+        trades += book.trades().size();
+        mid = book.trades().back().price;
+        book.clearTrades();
+      }
+    }
+  });
+
+  std::cout << "orderbook (" << n << " ops, " << trades << " trades, "
+            << book.orderCount() << " resting)" << std::endl;
+  report("order operations", n, seconds);
+
+  auto samePrint = [](const market::Trade &a, const market::Trade &b) {
+    return a.buyId == b.buyId && a.sellId == b.sellId &&
+           a.price == b.price && a.quantity == b.quantity &&
+           a.aggressor == b.aggressor;
+  };
+  const size_t checked = std::min<size_t>(n, 200'000);
+  OrderBook fresh;
+  ReferenceBook reference;
+  live.clear();
+  mid = 2000;
+  size_t diverged = checked;
+  for (size_t i = 0; i < checked && diverged == checked; i++) {
+    const Op &op = ops[i];
+    bool agree = true;
+    switch (op.kind) {
+    case 0: {
+      int64_t price = quote(op, mid);
+      auto id = fresh.limit(op.side, price, op.quantity);
+      uint32_t left = reference.match(op.side, price, op.quantity);
+      agree = (id != OrderBook::NO_ORDER) == (left > 0);
+      if (id != OrderBook::NO_ORDER) {
+        live.push_back(id);
+        reference.rest(op.side, price, left, id);
+      }
+      break;
+    }
+    case 1:
+      if (!live.empty()) {
+        size_t k = op.pick % live.size();
+        agree = fresh.cancel(live[k]) == reference.cancel(live[k]);
+        live[k] = live.back();
+        live.pop_back();
+      }
+      break;
+    default: {
+      int64_t any = op.side == Side::Buy ? OrderBook::MAX_TICKS : -1;
+      agree = fresh.market(op.side, op.quantity) ==
+              op.quantity - reference.match(op.side, any, op.quantity);
+      break;
+    }
+    }
+    agree = agree && std::ranges::equal(fresh.trades(), reference.prints,
+                                        samePrint) &&
+            fresh.bestBid() == reference.bestBid() &&
+            fresh.bestAsk() == reference.bestAsk() &&
+            fresh.orderCount() == reference.orderCount();
+    if (!agree)
+      diverged = i;
+    if (!fresh.trades().empty())
+      mid = fresh.trades().back().price;
+    fresh.clearTrades();
+    reference.prints.clear();
+  }
+  if (diverged < checked) {
+    std::cout << "  reference book DIVERGES at op " << diverged << std::endl;
+    return 1;
+  }
+  std::cout << "  matches the reference book over " << checked << " ops"
+            << std::endl;
+  return 0;
+}
+
+// events [count]: timer wheel with `count` events spread over ~4M ticks.
+// Times scheduling, cancelling a tenth of them, 1000 ticks before the first
+// deadline (where pending events should cost nothing), and firing the rest
+// one tick at a time.
+int events(const std::vector<std::string> &args) {
+  const size_t n = argOr(args, 0, 5'000'000);
+  const uint64_t quiet = 1000;
+  struct Context {
+    size_t fired = 0;
+  };
+  using Wheel = ::events::TimerWheel<Context>;
+  Wheel wheel;
+  Context context;
+
+  auto &rng = util::rand::Random::get_engine();
+  std::vector<uint64_t> delays(n);
+  for (auto &d : delays)
+    d = quiet + rng.bounded(uint64_t{1} << 22);
+  std::vector<Wheel::EventId> ids(n);
+
+  std::cout << "events (" << n << " events)" << std::endl;
+  report("schedule", n, secondsFor([&] {
+           for (size_t i = 0; i < n; i++)
+             ids[i] = wheel.after(delays[i], [](Context &c) { c.fired++; });
+         }));
+  report("cancel", n / 10, secondsFor([&] {
+           for (size_t i = 0; i < n; i += 10)
+             wheel.cancel(ids[i]);
+         }));
+  double idle = secondsFor([&] {
+    for (uint64_t t = 1; t < quiet; t++)
+      wheel.advanceTo(context, t);
+  });
+  std::cout << "  idle tick with " << wheel.pending()
+            << " pending: " << idle * 1e9 / (quiet - 1) << " ns" << std::endl;
+  size_t due = wheel.pending();
+  uint64_t end = quiet + (uint64_t{1} << 22);
+  report("fire (stepping every tick)", due, secondsFor([&] {
+           for (uint64_t t = quiet; t <= end; t++)
+             wheel.advanceTo(context, t);
+         }));
+  std::cout << "  fired " << context.fired << " of " << due << std::endl;
+  return context.fired == due ? 0 : 1;
+}
+
+double checksum(const Economy &economy) {
+  const auto &pop = economy.traders;
+  double sum = 0.0;
+  for (size_t i = 0; i < pop.size(); i++)
+    sum += pop.balance[i] + pop.levels[i] + pop.shares[i];
+  for (const auto &e : economy.economySystem)
+    sum += e.value.toDouble() + e.level.toDouble();
+  for (const auto &s : economy.stocks)
+    sum += s.value.toDouble();
+  return sum;
+}
+
+// Shares held plus shares escrowed in resting sell orders; trading only
+// moves them between agents.
+int64_t sharesOutstanding(const ::agents::Population &pop,
+                          const std::vector<Stock> &stocks) {
+  int64_t total = 0;
+  for (size_t i = 0; i < pop.size(); i++) {
+    total += pop.shares[i];
+    if (pop.openSide[i] == static_cast<uint8_t>(market::Side::Sell))
+      total += stocks[pop.stock[i] % stocks.size()].book.remaining(
+          pop.openOrder[i]);
+  }
+  return total;
+}
+
+// agents [count] [ticks] [workers]: trader population driving a default
+// Economy at a fixed 60 Hz step. The checksum only depends on the seed, so
+// runs with different worker counts must print the same one. Shares must
+// be conserved, also after the stock is pushed past the book's top price.
+int agents(const std::vector<std::string> &args) {
+  const size_t count = argOr(args, 0, 1'000'000);
+  const size_t ticks = argOr(args, 1, 100);
+  Economy economy;
+  economy.traders.workers =
+      static_cast<unsigned>(argOr(args, 2, economy.traders.workers));
+  economy.traders.spawn(count);
+
+  std::array<uint64_t, ::agents::ACTION_COUNT> actions{};
+  double agentSeconds = 0.0;
+  double seconds = secondsFor([&] {
+    for (size_t t = 0; t < ticks; t++) {
+      agentSeconds += secondsFor([&] {
+        economy.traders.tick(economy.economySystem, economy.stocks,
+                             1.0f / 60.0f);
+      });
+      for (size_t a = 0; a < actions.size(); a++)
+        actions[a] += economy.traders.lastActions[a];
+      // Objects and stocks only; the population already ticked above.
+      for (auto &e : economy.economySystem)
+        e.update(1.0f / 60.0f);
+      for (auto &s : economy.stocks)
+        s.update(1.0f / 60.0f);
+    }
+  });
+
+  const auto &pop = economy.traders;
+  std::cout << "agents (" << count << " agents, " << ticks << " ticks, "
+            << pop.workers << " workers)" << std::endl;
+  report("agent decisions", count * ticks, agentSeconds);
+  std::cout << "  whole ticks: " << ticks / seconds << " ticks/s" << std::endl;
+  std::cout << "  actions: hold " << actions[0] << ", upgrade " << actions[1]
+            << ", gamble " << actions[2] << ", buy " << actions[3]
+            << ", sell " << actions[4] << std::endl;
+  std::cout << "  stock price: " << economy.stocks[0].value.toDouble()
+            << ", checksum: " << std::setprecision(17) << checksum(economy)
+            << std::endl;
+
+  const int64_t issued = static_cast<int64_t>(count) * 10;
+  int64_t before = sharesOutstanding(pop, economy.stocks);
+  economy.stocks[0].value =
+      2.0 * market::OrderBook::MAX_TICKS * economy.stocks[0].tickSize;
+  for (size_t t = 0; t < 10; t++)
+    economy.traders.tick(economy.economySystem, economy.stocks, 1.0f / 60.0f);
+  int64_t after = sharesOutstanding(pop, economy.stocks);
+  bool ok = before == issued && after == issued;
+  std::cout << "  shares " << (ok ? "conserved" : "LOST") << " (" << before
+            << ", " << after << " past the top price, of " << issued << ")"
+            << std::endl;
+  return ok ? 0 : 1;
+}
+
+// market [objects] [ticks]: market-wide aggregates kept up by
+// Economy::update, checked against a full rescan at the end. Then one
+// object's value shoots up to 1e300 and collapses back to 1; the total
+// has to come back from that exactly too.
+int market(const std::vector<std::string> &args) {
+  const size_t count = argOr(args, 0, 100'000);
+  const size_t ticks = argOr(args, 1, 120);
+  const size_t k = 5;
+  Economy economy;
+  std::mt19937_64 gen(7);
+  std::lognormal_distribution<double> startValue(3.0, 2.0);
+  std::uniform_real_distribution<double> startLevel(-2.0, 5.0);
+  for (size_t i = 0; i < count; i++)
+    economy.economySystem.emplace_back(startValue(gen), 64, startLevel(gen));
+  const auto &objects = economy.economySystem;
+  const auto &aggregates = economy.aggregates;
+
+  double seconds = secondsFor([&] {
+    for (size_t t = 0; t < ticks; t++)
+      economy.update(1.0 / 60.0);
+  });
+
+  // The rescan the aggregates stand in for.
+  util::BigNumber total;
+  std::vector<double> values;
+  std::vector<std::pair<double, size_t>> moves;
+  double scanSeconds = secondsFor([&] {
+    values.clear();
+    moves.clear();
+    total = 0.0;
+    for (size_t i = 0; i < objects.size(); i++) {
+      total += objects[i].value;
+      values.push_back(objects[i].value.toDouble());
+      moves.push_back({std::abs(market::Aggregates::change(objects[i])), i});
+    }
+    std::sort(values.begin(), values.end());
+    std::partial_sort(moves.begin(), moves.begin() + k, moves.end(),
+                      std::greater<>());
+  });
+  double querySeconds = secondsFor([&] {
+    volatile double sink =
+        (aggregates.total() + aggregates.percentile(0.5) +
+         aggregates.percentile(0.99))
+            .toDouble();
+    sink = sink + aggregates.topMovers(objects, k).size();
+  });
+
+  bool ok = abs(aggregates.total() - total) <= abs(total) * 1e-9;
+  std::cout << "market (" << objects.size() << " objects, " << ticks
+            << " ticks)" << std::endl;
+  std::cout << "  update: " << seconds * 1e3 / ticks
+            << " ms/tick, query: " << querySeconds * 1e6
+            << " us, full rescan: " << scanSeconds * 1e3 << " ms" << std::endl;
+  std::cout << "  total " << aggregates.total().format().data() << " (rescan "
+            << total.format().data() << "), index "
+            << aggregates.index().format().data() << std::endl;
+  for (double q : {0.1, 0.5, 0.9, 0.99}) {
+    double exact = values[static_cast<size_t>(q * (values.size() - 1))];
+    double sketched = aggregates.percentile(q).toDouble();
+    ok &= std::abs(sketched - exact) <= 0.0101 * std::abs(exact);
+    std::cout << "  p" << q * 100 << ": " << sketched << " (exact " << exact
+              << ")" << std::endl;
+  }
+  auto top = aggregates.topMovers(objects, k);
+  for (size_t i = 0; i < k && i < top.size(); i++) {
+    ok &= std::abs(top[i].change) == moves[i].first;
+    std::cout << "  mover " << i + 1 << ": #" << top[i].object << " "
+              << top[i].change * 100 << "% (exact #" << moves[i].second
+              << ")" << std::endl;
+  }
+
+  auto rescanTotal = [&] {
+    util::BigNumber sum;
+    for (const auto &e : objects)
+      sum += e.value;
+    return sum;
+  };
+  EconomyObject &dominant = economy.economySystem[count / 2];
+  dominant.value = util::BigNumber(1e300);
+  economy.update(1.0 / 60.0);
+  dominant.value = util::BigNumber(1.0);
+  economy.update(1.0 / 60.0);
+  util::BigNumber after = rescanTotal();
+  bool recovered = abs(aggregates.total() - after) <= abs(after) * 1e-9;
+  ok &= recovered;
+  std::cout << "  after a 1e300 value collapses: total "
+            << aggregates.total().format().data() << " (rescan "
+            << after.format().data() << ")" << std::endl;
+
+  std::cout << "  " << (ok ? "aggregates match" : "aggregates DIVERGE")
+            << std::endl;
+  return ok ? 0 : 1;
+}
+
+// numbers [ops]: util::BigNumber against the double it replaced for economy
+// values, op by op and through the default rate formula.
+int numbers(const std::vector<std::string> &args) {
+  const size_t n = argOr(args, 0, 10'000'000);
+  using util::BigNumber;
+  std::vector<double> a(4096), b(4096);
+  auto &rng = util::rand::Random::get_engine();
+  for (size_t i = 0; i < a.size(); i++) {
+    a[i] = std::exp2(static_cast<double>(rng.bounded(64)) - 16.0) *
+           (1.0 + static_cast<double>(rng.bounded(1000)) / 1000.0);
+    b[i] = std::exp2(static_cast<double>(rng.bounded(64)) - 16.0) *
+           (1.0 + static_cast<double>(rng.bounded(1000)) / 1000.0);
+  }
+  std::vector<BigNumber> bigA(a.begin(), a.end()), bigB(b.begin(), b.end());
+  const size_t mask = a.size() - 1;
+  volatile double sink = 0.0;
+
+  std::cout << "numbers (" << n << " ops, " << sizeof(BigNumber)
+            << " bytes per BigNumber)" << std::endl;
+  auto compare = [&](const char *name, auto &&op) {
+    double acc = 0.0;
+    BigNumber bigAcc;
+    report(std::string("double ") + name, n, secondsFor([&] {
+             for (size_t i = 0; i < n; i++)
+               acc += op(a[i & mask], b[(i * 7) & mask]);
+           }));
+    report(std::string("BigNumber ") + name, n, secondsFor([&] {
+             for (size_t i = 0; i < n; i++)
+               bigAcc += op(bigA[i & mask], bigB[(i * 7) & mask]);
+           }));
+    sink = sink + acc + bigAcc.toDouble();
+  };
+  compare("add", [](auto x, auto y) { return x + y; });
+  compare("mul", [](auto x, auto y) { return x * y; });
+  compare("div", [](auto x, auto y) { return x / y; });
+  compare("log", [](auto x, auto) {
+    using std::log;
+    return log(x);
+  });
+  compare("pow", [](auto x, auto) {
+    using std::pow;
+    return pow(x, decltype(x)(1.15));
+  });
+
+  // The per-tick work of an EconomyObject: "+V0,V1" on (value, level * dt).
+  const size_t evaluations = n / 10;
+  util::LogicEvaluator<double> formula("+V0,V1");
+  util::LogicEvaluator<BigNumber> bigFormula("+V0,V1");
+  double value = 1.0;
+  BigNumber bigValue = 1.0;
+  report("double formula", evaluations, secondsFor([&] {
+           for (size_t i = 0; i < evaluations; i++)
+             value = formula.evaluate({value, a[i & mask] / 60.0});
+         }));
+  report("BigNumber formula", evaluations, secondsFor([&] {
+           for (size_t i = 0; i < evaluations; i++)
+             bigValue = bigFormula.evaluate(
+                 {bigValue, bigA[i & mask] * BigNumber(1.0 / 60.0)});
+         }));
+  double drift = std::abs(bigValue.toDouble() - value) / value;
+  std::cout << "  formula results " << value << " / "
+            << bigValue.toDouble() << " (relative difference " << drift
+            << ")" << std::endl;
+  sink = sink + drift;
+
+  // Exponent sums and differences past int64 have to saturate, not wrap.
+  const int64_t top = BigNumber::MAX_EXPONENT;
+  BigNumber huge = BigNumber::fromParts(1.5, top);
+  BigNumber tiny = BigNumber::fromParts(1.5, -top);
+  bool saturates = !isfinite(huge * huge) && (tiny * tiny).isZero() &&
+                   !isfinite(huge / tiny) && (tiny / huge).isZero() &&
+                   huge + tiny == huge && tiny - huge == -huge &&
+                   !isfinite(BigNumber::fromParts(1.0, INT64_MAX)) &&
+                   BigNumber::fromParts(1.0, INT64_MIN).isZero();
+  std::cout << "  exponent overflow "
+            << (saturates ? "saturates" : "WRAPS") << std::endl;
+  return drift <= 1e-9 && saturates ? 0 : 1;
+}
+
+// shards [objects] [ticks] [max workers] [min efficiency %]: the same
+// objects stepped in this process and in 1, 2, 4, ... worker processes. A
+// quarter of the objects run a heavier formula, so the equal-count starting
+// split is uneven and the coordinator has to rebalance. Some of the rest
+// average over more samples than their history keeps, or use an EMA, so an
+// object that migrates without its window state drifts. Every run must end
+// on the in-process values, and every run with no more workers than cores
+// must keep the given efficiency against the single worker.
+int shards(const std::vector<std::string> &args) {
+  const size_t count = argOr(args, 0, 50'000);
+  const size_t ticks = argOr(args, 1, 300);
+  const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  const size_t maxWorkers = argOr(args, 2, cores);
+  const double minEfficiency = argOr(args, 3, 70) / 100.0;
+  const float dt = 1.0f / 60.0f;
+  std::vector<EconomyObject> objects;
+  objects.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    const char *rate = i < count / 4 ? "+V0,*V1,+1,/A32,+1,sD32"
+                       : i % 8 == 1  ? "+V0,*V1,/A200,+V0,1"
+                       : i % 8 == 2  ? "+V0,*V1,/E16,+V0,1"
+                                     : nullptr;
+    objects.emplace_back(1.0 + i % 100, 64, 1.0 + i % 7, nullptr, rate);
+  }
+
+  std::vector<EconomyObject> reference = objects;
+  double serial = secondsFor([&] {
+    for (size_t t = 0; t < ticks; t++)
+      for (auto &e : reference)
+        e.update(dt);
+  });
+  std::map<std::string, double> expected;
+  for (const auto &e : reference)
+    expected[e.uuid] = e.value.toDouble();
+
+  std::cout << "shards (" << count << " objects, " << ticks << " ticks, "
+            << std::thread::hardware_concurrency() << " cores)" << std::endl;
+  std::cout << "  in process: " << ticks / serial << " ticks/s" << std::endl;
+  bool ok = true;
+  double single = 0.0;
+  for (size_t workers = 1; workers <= maxWorkers; workers *= 2) {
+    shards::Cluster cluster(objects, static_cast<unsigned>(workers));
+    double seconds = secondsFor([&] {
+      for (size_t t = 0; t < ticks; t++)
+        cluster.tick(dt);
+    });
+    if (workers == 1)
+      single = seconds;
+
+    double worst = 0.0;
+    for (const auto &e : cluster.gather()) {
+      double want = expected.at(e.uuid);
+      worst = std::max(worst, std::abs(e.value.toDouble() - want) /
+                                  std::max(std::abs(want), 1.0));
+    }
+    double efficiency = single / seconds / workers;
+    bool slow = workers <= cores && efficiency < minEfficiency;
+    ok &= worst <= 1e-9 && !slow;
+    std::cout << "  " << workers << " workers: " << ticks / seconds
+              << " ticks/s, speedup " << single / seconds << "x ("
+              << efficiency * 100.0 << "% efficiency), "
+              << cluster.migratedObjects() << " objects moved, shards";
+    for (const auto &s : cluster.shards())
+      std::cout << " " << s.objects;
+    std::cout << (worst <= 1e-9 ? "" : ", values DIVERGE")
+              << (slow ? ", BELOW minimum efficiency" : "")
+              << (workers > cores ? " (more workers than cores, not checked)"
+                                  : "")
+              << std::endl;
+  }
+  return ok ? 0 : 1;
+}
+
+// journal [objects] [ticks]: an autosaving economy that scans every second,
+// journals an upgrade and a gamble per tick and compacts every 256 KB,
+// so all record kinds and checkpoints get written. Reports what the
+// simulation thread pays per tick, then tears the journal's tail and
+// recovers; every object must come back as it was at the last sync,
+// history included, and the recovered objects must go on to the same
+// values as the saved ones. Some objects average over more samples than
+// their history keeps, or use an EMA, so window state has to come back too.
+// One object is boosted by 5 levels past the sync: it has to come back
+// without them. Another boost runs out before the sync. Last, an event
+// lands on an object that a checkpoint in progress has already copied,
+// and the save stops before any scan: the event has to come back.
+int journal(const std::vector<std::string> &args) {
+  const size_t count = argOr(args, 0, 10'000);
+  const size_t ticks = argOr(args, 1, 600);
+  const float dt = 1.0f / 60.0f;
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() /
+      ("simulasi-journal-" + std::to_string(::getpid()));
+  std::filesystem::remove_all(directory);
+
+  Economy economy;
+  economy.economySystem.clear();
+  for (size_t i = 0; i < count; i++) {
+    const char *rate = i % 8 == 1   ? "+V0,*V1,/A200,+V0,1"
+                       : i % 8 == 2 ? "+V0,*V1,/E16,+V0,1"
+                                    : nullptr;
+    economy.economySystem.emplace_back(1.0 + i % 100, 64, 1.0 + i % 7,
+                                       nullptr, rate);
+  }
+
+  ::journal::Stats stats;
+  double total = 0.0;
+  double worst = 0.0;
+  std::vector<double> cpu; // per tick
+  std::vector<EconomyObject> saved;
+  {
+    ::journal::Autosave save(directory);
+    save.interval = 1.0;
+    save.compactBytes = uint64_t{256} << 10;
+    for (size_t t = 0; t < ticks; t++) {
+      economy.update(dt);
+      EconomyObject &e = economy.economySystem[t * 7919 % count];
+      if (t == ticks / 4 || t == ticks / 2) {
+        EconomyObject &boosted = economy.economySystem[t == ticks / 2];
+        economy.boostLevel(boosted, 5.0, t == ticks / 2 ? 1e6 : 1.0);
+        save.gambled(economy, boosted, "d20 boost", 1);
+      }
+      double start = threadSeconds();
+      double seconds = secondsFor([&] {
+        if (e.upgradeLevel())
+          save.upgraded(economy, e, 1.0);
+        ::gambling::Dice::d10().rollBatch(e.value, 4);
+        save.gambled(economy, e, ::gambling::Dice::d10().getName(), 4);
+        save.update(economy, dt);
+      });
+      cpu.push_back(threadSeconds() - start);
+      total += seconds;
+      worst = std::max(worst, seconds);
+    }
+    save.sync(economy);
+    stats = save.stats();
+    saved = economy.economySystem;
+    saved[1].level -= 5.0;
+  }
+  // A crash halfway through appending a frame.
+  std::ofstream(directory / "journal.log", std::ios::app | std::ios::binary)
+      << "\x40\x00\x00\x00torn";
+
+  Economy restored;
+  bool recovered = ::journal::Autosave(directory).recover(restored);
+  std::filesystem::remove_all(directory);
+  auto same = [](const EconomyObject &a, const EconomyObject &b) {
+    bool equal = a.uuid == b.uuid && a.value == b.value &&
+                 a.level == b.level && a.historySamples == b.historySamples &&
+                 a.history.size() == b.history.size();
+    for (size_t i = 0; equal && i < a.history.size(); i++)
+      equal = a.history[i] == b.history[i];
+    return equal;
+  };
+  size_t matching = 0;
+  size_t matchingLater = 0;
+  if (restored.economySystem.size() == count) {
+    for (size_t i = 0; i < count; i++)
+      matching += same(restored.economySystem[i], saved[i]);
+    for (size_t t = 0; t < 30; t++)
+      for (size_t i = 0; i < count; i++) {
+        restored.economySystem[i].update(dt);
+        saved[i].update(dt);
+      }
+    for (size_t i = 0; i < count; i++)
+      matchingLater += same(restored.economySystem[i], saved[i]);
+  }
+
+  // A checkpoint is copied over several frames. An event on an object it
+  // already holds has to reach the next journal as well, or a crash
+  // before that object's next scan brings back the older copy.
+  EconomyObject::Number held;
+  {
+    ::journal::Autosave save(directory);
+    save.interval = 1e9; // no scan gets back to the object
+    save.captureSeconds = 0.1;
+    save.update(restored, dt);
+    EconomyObject &e = restored.economySystem[0];
+    e.value += 1.0;
+    held = e.value;
+    save.gambled(restored, e, "d20", 1);
+    for (size_t t = 0; t < 10; t++)
+      save.update(restored, dt);
+  }
+  Economy reloaded;
+  ::journal::Autosave(directory).recover(reloaded);
+  std::filesystem::remove_all(directory);
+  bool heldEvents = !reloaded.economySystem.empty() &&
+                    reloaded.economySystem[0].value == held;
+
+  bool ok = recovered && matching == count && matchingLater == count &&
+            stats.checkpoints > 1 && heldEvents;
+  std::cout << "journal (" << count << " objects, " << ticks << " ticks)"
+            << std::endl;
+  std::sort(cpu.begin(), cpu.end());
+  std::cout << "  simulation thread: " << total * 1e6 / ticks
+            << " us/tick mean, " << worst * 1e6 << " us worst; own CPU time "
+            << cpu[cpu.size() * 99 / 100] * 1e6 << " us 99th percentile, "
+            << cpu.back() * 1e6 << " us worst" << std::endl;
+  std::cout << "  " << stats.records << " records, " << stats.commits
+            << " commits, " << stats.checkpoints << " checkpoints, last commit "
+            << stats.lastCommitSeconds * 1e3 << " ms" << std::endl;
+  std::cout << "  recovery " << (ok ? "matches" : "DIVERGES") << " ("
+            << matching << " / " << count << " objects, " << matchingLater
+            << " after 30 more ticks)" << std::endl;
+  std::cout << "  events during a checkpoint's capture "
+            << (heldEvents ? "kept" : "LOST") << std::endl;
+  return ok ? 0 : 1;
+}
+
+// timeline [agents] [ticks] [objects]: snapshots a trading economy every
+// tick, then rewinds to the midpoint and replays. The replay has to land on
+// the same checksum as the first run. Every eighth object reads a 32-sample
+// window, so some copies carry window state.
+int timeline(const std::vector<std::string> &args) {
+  const size_t count = argOr(args, 0, 1'000'000);
+  const size_t ticks = argOr(args, 1, 60);
+  const size_t objects = argOr(args, 2, 0);
+  const float dt = 1.0f / 60.0f;
+  Economy economy;
+  economy.traders.spawn(count);
+  for (size_t i = 0; i < objects; i++)
+    economy.economySystem.emplace_back(1.0 + i % 100, 64, 1.0, nullptr,
+                                       i % 8 ? nullptr : "+V0,*V1,/A32,+V0,1");
+  ::Timeline timeline(SIZE_MAX, 0.0);
+
+  size_t stateBytes = persistent::liveBytes();
+  double captureSeconds = 0.0;
+  double updateSeconds = 0.0;
+  for (size_t t = 0; t < ticks; t++) {
+    updateSeconds += secondsFor([&] { economy.update(dt); });
+    captureSeconds += secondsFor([&] { timeline.update(economy, dt); });
+  }
+  double first = checksum(economy);
+  size_t retained = persistent::liveBytes();
+  size_t copied = timeline.bytes() - retained;
+
+  size_t middle = timeline.size() / 2;
+  double restoreSeconds =
+      secondsFor([&] { timeline.restore(middle, economy); });
+  for (size_t t = middle + 1; t < ticks; t++)
+    economy.update(dt);
+  double replay = checksum(economy);
+
+  // The budget has to hold against everything a snapshot keeps, not just
+  // the chunks: room for the live state and about ten snapshots' chunks
+  // and copies.
+  timeline = ::Timeline();
+  ::Timeline bounded(persistent::liveBytes() +
+                         (retained - stateBytes + copied) / ticks * 10,
+                     0.0);
+  for (size_t t = 0; t < ticks; t++) {
+    economy.update(dt);
+    bounded.update(economy, dt);
+  }
+  bool withinBudget = bounded.bytes() <= bounded.budget;
+
+  std::cout << "timeline (" << count << " agents, "
+            << economy.economySystem.size() << " objects, " << ticks
+            << " snapshots)" << std::endl;
+  std::cout << "  capture: " << captureSeconds * 1e6 / ticks
+            << " us/snapshot, restore: " << restoreSeconds * 1e6 << " us"
+            << std::endl;
+  std::cout << "  update after a capture: " << updateSeconds * 1e3 / ticks
+            << " ms" << std::endl;
+  std::cout << "  memory per snapshot: "
+            << (retained - stateBytes) / 1048576.0 / ticks << " MB of chunks, "
+            << copied / 1048576.0 / ticks << " MB of copies ("
+            << stateBytes / 1048576.0 << " MB live state)" << std::endl;
+  std::cout << "  a " << bounded.budget / 1048576.0 << " MB budget keeps "
+            << bounded.size() << " snapshots in "
+            << bounded.bytes() / 1048576.0 << " MB"
+            << (withinBudget ? "" : ", OVER BUDGET") << std::endl;
+  std::cout << "  replay " << (first == replay ? "matches" : "DIVERGES")
+            << " (" << std::setprecision(17) << first << " vs " << replay
+            << ")" << std::endl;
+  return first == replay && withinBudget ? 0 : 1;
+}
+} // namespace bench
+
+int main(int argc, char **argv) {
+  const std::map<std::string,
+                 std::function<int(const std::vector<std::string> &)>>
+      modes = {
+          {"agents", bench::agents},
+          {"events", bench::events},
+          {"journal", bench::journal},
+          {"market", bench::market},
+          {"numbers", bench::numbers},
+          {"orderbook", bench::orderbook},
+          {"rng", bench::rng},
+          {"shards", bench::shards},
+          {"timeline", bench::timeline},
+      };
+
+  if (argc < 2 || !modes.contains(argv[1])) {
+    std::cerr << "usage: " << argv[0] << " <mode> [args...]\nmodes:";
+    for (auto &[name, _] : modes)
+      std::cerr << " " << name;
+    std::cerr << std::endl;
+    return 1;
+  }
+  return modes.at(argv[1])(std::vector<std::string>(argv + 2, argv + argc));
+}
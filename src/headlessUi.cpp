@@ -0,0 +1,148 @@
+// Headless UI benchmark: builds the game's windows (gui/windows.hpp) against
+// an ImGui context with no platform or renderer backend, so it needs no
+// display, GL context or GPU. The draw lists are generated but never drawn.
+// Usage: headless-ui.out [frames] [object counts...]
+#include "allocationCounter.hpp"
+#include "economy/economy.hpp"
+#include "economy/timeline.hpp"
+#include "gui/windows.hpp"
+#include "imgui.h"
+#include "metrics.hpp"
+#include "profiler.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench {
+using Clock = std::chrono::steady_clock;
+
+// ImGui allocates through its own hooks rather than operator new; route
+// them into the same tally so both show up in the per-frame counts.
+void *countedAlloc(size_t size, void *) {
+  metrics::alloc::record(size);
+  return std::malloc(size);
+}
+void countedFree(void *p, void *) { std::free(p); }
+
+void createContext() {
+  ImGui::SetAllocatorFunctions(countedAlloc, countedFree);
+  ImGui::CreateContext();
+  ImGuiIO &io = ImGui::GetIO();
+  io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+  io.DisplaySize = ImVec2(1920.0f, 1080.0f);
+  io.DeltaTime = 1.0f / 60.0f;
+  io.IniFilename = nullptr;
+  // Builds the font atlas a renderer backend would otherwise upload.
+  unsigned char *pixels = nullptr;
+  int width = 0, height = 0;
+  io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+  ImGui::StyleColorsDark();
+}
+
+struct Totals {
+  double build = 0.0;
+  double render = 0.0;
+  double vertices = 0.0;
+  double indices = 0.0;
+  double drawLists = 0.0;
+  double allocations = 0.0;
+  double allocatedBytes = 0.0;
+  std::map<const char *, double> zones;
+};
+
+// One frame the way main.cpp builds it, minus the backends. The economy is
+// stepped outside the timed part.
+void frame(Economy &economy, Timeline &timeline, gui::windows::State &ui,
+           Totals &totals) {
+  const float dt = 1.0f / 60.0f;
+  economy.update(dt);
+  timeline.update(economy, dt);
+
+  double allocations = metrics::alloc::count();
+  double allocatedBytes = metrics::alloc::bytes();
+  auto start = Clock::now();
+  ImGui::NewFrame();
+  ImGui::DockSpaceOverViewport(0, ImGui::GetMainViewport());
+  gui::windows::mainMenu();
+  gui::windows::economyManagement(economy, ui);
+  gui::windows::gambling(economy, ui);
+  gui::windows::debug(economy, timeline, ui, dt);
+  ImGui::EndFrame();
+  auto built = Clock::now();
+  ImGui::Render();
+  auto rendered = Clock::now();
+
+  const ImDrawData *draw = ImGui::GetDrawData();
+  totals.build += std::chrono::duration<double>(built - start).count();
+  totals.render += std::chrono::duration<double>(rendered - built).count();
+  totals.vertices += draw->TotalVtxCount;
+  totals.indices += draw->TotalIdxCount;
+  totals.drawLists += draw->CmdListsCount;
+  totals.allocations += metrics::alloc::count() - allocations;
+  totals.allocatedBytes += metrics::alloc::bytes() - allocatedBytes;
+}
+
+int run(size_t objects, size_t frames) {
+  Economy economy;
+  std::mt19937_64 gen(objects);
+  std::lognormal_distribution<double> startValue(3.0, 2.0);
+  std::uniform_real_distribution<double> startLevel(0.0, 5.0);
+  while (economy.economySystem.size() < objects) {
+    std::string name = "Object " + std::to_string(economy.economySystem.size());
+    economy.economySystem.emplace_back(startValue(gen), 1024, startLevel(gen),
+                                       nullptr, nullptr, name.c_str());
+  }
+  Timeline timeline;
+  gui::windows::State ui(economy);
+  createContext();
+
+  // Let windows settle their sizes and the list caches fill before timing.
+  Totals warmup;
+  for (size_t i = 0; i < 10; i++)
+    frame(economy, timeline, ui, warmup);
+
+  Totals totals;
+  for (size_t i = 0; i < frames; i++) {
+    PROFILE_FRAME();
+    frame(economy, timeline, ui, totals);
+    for (const auto &zone : profiler::FrameProfiler::get().lastFrame())
+      if (zone.depth == 0)
+        totals.zones[zone.name] += (zone.end - zone.start) / 1e6;
+  }
+  ImGui::DestroyContext();
+
+  double n = static_cast<double>(frames);
+  std::cout << "ui (" << economy.economySystem.size() << " objects, "
+            << frames << " frames)" << std::endl;
+  std::cout << "  build: " << totals.build * 1e3 / n
+            << " ms/frame, render: " << totals.render * 1e3 / n
+            << " ms/frame" << std::endl;
+  std::cout << "  draw data: " << totals.vertices / n << " vertices, "
+            << totals.indices / n << " indices, " << totals.drawLists / n
+            << " draw lists per frame" << std::endl;
+  std::cout << "  allocations: " << totals.allocations / n << " per frame ("
+            << totals.allocatedBytes / n / 1024.0 << " KB)" << std::endl;
+  for (const auto &[name, ms] : totals.zones)
+    std::cout << "  " << name << ": " << ms / n << " ms/frame" << std::endl;
+  return 0;
+}
+} // namespace bench
+
+int main(int argc, char **argv) {
+  size_t frames = argc > 1 ? std::stoull(argv[1]) : 300;
+  std::vector<size_t> counts;
+  for (int i = 2; i < argc; i++)
+    counts.push_back(std::stoull(argv[i]));
+  if (counts.empty())
+    counts = {10, 1'000, 10'000};
+
+  for (size_t objects : counts)
+    if (int status = bench::run(objects, frames))
+      return status;
+  return 0;
+}
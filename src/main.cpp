@@ -1,18 +1,28 @@
-#include "economy/base.hpp"
-#include "gui/core.hpp"
-#include "gui/selectionMenu.hpp"
+#include "allocationCounter.hpp"
+#include "economy/economy.hpp"
+#include "economy/journal.hpp"
+#include "economy/timeline.hpp"
+#include "gui/backend.hpp"
+#include "gui/windows.hpp"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "metricsServer.hpp"
+#include "profiler.hpp"
 #include "utils.hpp"
 #include <GLFW/glfw3.h>
 #include <algorithm>
 #include <cfloat>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <filesystem>
 #include <functionlang.hpp>
 #include <glm/glm.hpp>
+#include <iostream>
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -45,35 +55,38 @@ const float aspecty = 9;
 const int height = width * (aspecty / aspectx);
 } // namespace settings
 
-class Economy {
-public:
-  std::vector<EconomyObject> economySystem;
-  void update(double dt) {
-    for (auto &e : economySystem) {
-      e.update(dt);
-    }
-  }
-
-  Economy() {
-    economySystem.push_back(
-        EconomyObject(1.0, 1024, 1.0, nullptr, nullptr, "Base Stock"));
-    economySystem.push_back(
-        EconomyObject(0.0, 1024, 0.0, "*10,^2,V1", nullptr, "Advanced Stock"));
-  }
-};
-
 namespace game_data {
 Economy economy;
-gui::selectionMenu::EconomyObjectSelectionMenu
-    g_EconomySelect(&economy.economySystem);
+Timeline timeline;
+gui::windows::State ui(economy);
+metrics::Server metricsServer;
+int metricsPort = 9464;
+const char *saveDirectory = "save";
+std::unique_ptr<journal::Autosave> autosave;
 } // namespace game_data
 
+void openSave();
 void initGlfw();
 void initImGui();
 int cleanup();
 GLFWwindow *window = nullptr;
 
-int main() {
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+      game_data::metricsPort = std::clamp(std::atoi(argv[++i]), 1, 65535);
+      // Like the Debug window's toggle: the game runs on without it, and
+      // the endpoint can be retried from there.
+      if (!game_data::metricsServer.start(game_data::metricsPort))
+        std::cerr << "Could not start the metrics endpoint on port "
+                  << game_data::metricsPort << "; starting without it"
+                  << std::endl;
+    } else if (std::strcmp(argv[i], "--save-dir") == 0 && i + 1 < argc) {
+      game_data::saveDirectory = argv[++i];
+    }
+  }
+  openSave();
+  game_data::ui.autosave = game_data::autosave.get();
   initGlfw();
   initImGui();
 
@@ -81,186 +94,105 @@ int main() {
   float lastFrame = 0.0f;
   float deltaTime = 0.0f;
 
-  double e_UpgradeCountSelected = 1.0;
   while (!glfwWindowShouldClose(window)) {
+    PROFILE_FRAME();
     float currentFrame = static_cast<float>(glfwGetTime());
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
     game_data::economy.update(deltaTime);
+    game_data::timeline.update(game_data::economy, deltaTime);
+    game_data::autosave->update(game_data::economy, deltaTime);
 
     glfwPollEvents();
 
     gui::setupFrame();
 
-    {
-      ImGui::Begin("Main Menu");
-      ImGui::SeparatorText("General");
-      if (ImGui::Button("Quit")) {
-        glfwSetWindowShouldClose(window, true);
-      }
-
-      ImGui::End();
+    if (gui::windows::mainMenu()) {
+      glfwSetWindowShouldClose(window, true);
     }
-    {
-      ImGui::Begin("Economy Management", nullptr, ImGuiWindowFlags_NoCollapse);
-      // --- Header Section ---
-      ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "Market Status");
-      ImGui::Separator();
-
-      ImGui::BeginChild("##Economy Management",
-                        ImVec2(ImGui::GetWindowSize().x, 600.0));
-      gui::doubleInput(e_UpgradeCountSelected, 0.1, 10.0,
-                       "Level Upgrade Count");
-      for (auto &e : game_data::economy.economySystem) {
-        float currentVal = e.value;
-        float requiredSpend = e.getValueForLevelUpgrade(e_UpgradeCountSelected);
-        bool canAfford = currentVal >= requiredSpend;
-
-        ImGui::PushID(e.name.c_str());
-
-        // --- Graph Section ---
-        ImGui::PlotLines("##History", e.history.data(), e.history.size(), 0,
-                         e.name.c_str(), e.minValue, e.maxValue,
-                         ImVec2(ImGui::GetContentRegionAvail().x, 120));
-
-        // --- Stats Table ---
-        if (ImGui::BeginTable("Stats", 2, ImGuiTableFlags_BordersInnerH)) {
-          ImGui::TableNextRow();
-          ImGui::TableSetColumnIndex(0);
-          ImGui::Text("Current Value:");
-          ImGui::TableSetColumnIndex(1);
-          ImGui::Text("%.2f", currentVal);
-
-          ImGui::TableNextRow();
-          ImGui::TableSetColumnIndex(0);
-          ImGui::Text("Growth Rate (LV):");
-          ImGui::TableSetColumnIndex(1);
-          ImGui::Text("%.2f / sec", e.level);
-
-          ImGui::EndTable();
-        }
-        ImGui::Spacing();
-        ImGui::SeparatorText("Formulas");
-        if (ImGui::BeginTable("##Formulas", 2, ImGuiTableFlags_BordersInnerH)) {
-          ImGui::TableNextRow();
-          ImGui::TableSetColumnIndex(0);
-          ImGui::Text("Name");
-          ImGui::TableSetColumnIndex(1);
-          ImGui::Text("Formula");
-
-          ImGui::TableNextRow();
-          ImGui::TableSetColumnIndex(0);
-          ImGui::Text("Level Cost");
-          ImGui::TableSetColumnIndex(1);
-          ImGui::Text("%s", e.upgradeLevelFormula.getSource().c_str());
-
-          ImGui::TableNextRow();
-          ImGui::TableSetColumnIndex(0);
-          ImGui::Text("Rate Increase");
-          ImGui::TableSetColumnIndex(1);
-          ImGui::Text("%s", e.rateIncreaseFormula.getSource().c_str());
-          ImGui::EndTable();
-        }
-
-        ImGui::Spacing();
-        ImGui::SeparatorText("Actions");
-
-        ImGui::Spacing();
-
-        // --- Upgrade Section ---
-        // Change style for the upgrade button based on affordability
-        if (!canAfford) {
-          ImGui::PushStyleColor(ImGuiCol_Button,
-                                ImVec4(0.4f, 0.1f, 0.1f, 1.0f));
-        } else {
-          ImGui::PushStyleColor(ImGuiCol_Button,
-                                ImVec4(0.1f, 0.4f, 0.1f, 1.0f));
-        }
-
-        if (gui::buttonFormat("Upgrade Level (Cost: {:.2f})",
-                              ImVec2(ImGui::GetContentRegionAvail().x, 30),
-                              requiredSpend) &&
-            canAfford) {
-          e.value -= requiredSpend;
-          e.level += e_UpgradeCountSelected;
-        }
-        ImGui::PopStyleColor();
-
-        // Progress bar for the next upgrade
-        float progress = std::clamp(currentVal / requiredSpend, 0.0f, 1.0f);
-        ImGui::ProgressBar(progress, ImVec2(-FLT_MIN, 0),
-                           canAfford ? "READY TO UPGRADE"
-                                     : "Accumulating Funds...");
-        ImGui::PopID();
-      }
-      ImGui::EndChild();
+    gui::windows::economyManagement(game_data::economy, game_data::ui);
+    gui::windows::gambling(game_data::economy, game_data::ui);
+    gui::windows::debug(
+        game_data::economy, game_data::timeline, game_data::ui, deltaTime,
+        [] {
+          if (ImGui::InputText("Window Title", settings::windowTitle,
+                               IM_ARRAYSIZE(settings::windowTitle))) {
+            glfwSetWindowTitle(window, settings::windowTitle);
+          }
+          ImGui::ColorEdit4("Edit Background Color",
+                            &settings::clearColor[0]);
+          bool serveMetrics = game_data::metricsServer.isRunning();
+          ImGui::SetNextItemWidth(120);
+          ImGui::InputInt("Metrics Port", &game_data::metricsPort);
+          game_data::metricsPort =
+              std::clamp(game_data::metricsPort, 1, 65535);
+          ImGui::SameLine();
+          if (ImGui::Checkbox("Serve Metrics", &serveMetrics)) {
+            if (serveMetrics)
+              game_data::metricsServer.start(game_data::metricsPort);
+            else
+              game_data::metricsServer.stop();
+          }
+          if (game_data::metricsServer.isRunning()) {
+            ImGui::Text("Prometheus: http://127.0.0.1:%u/metrics",
+                        game_data::metricsServer.port());
+          }
+        });
+    ImGui::EndFrame();
+    ImGui::UpdatePlatformWindows();
 
-      ImGui::End();
-    }
     {
-      ImGui::Begin("Gambling");
-      auto &items = game_data::economy.economySystem;
-      game_data::g_EconomySelect.display();
-      size_t gt_selectedEconomyIndex = game_data::g_EconomySelect.getIndex();
-      if (gt_selectedEconomyIndex != (size_t)-1) {
-        if (ImGui::Button("d20")) {
-          double n =
-              (double)util::rand::Random::get_int(1, 20); // if > d15, mult up
-          items[gt_selectedEconomyIndex].value *= pow(2, (n - 15) / 6.7);
-        }
-        ImGui::SameLine();
-        if (ImGui::Button("d10")) {
-          double n = (double)util::rand::Random::get_int(1, 10);
-          items[gt_selectedEconomyIndex].value *= pow(1.2, (n - 4.6) / 3.1);
-        }
-        ImGui::SameLine();
-        if (ImGui::Button("d4")) {
-          double n = (double)util::rand::Random::get_int(1, 4);
-          items[gt_selectedEconomyIndex].value *= pow(2, (n - 2.9) / 14.1);
-        }
-        ImGui::SameLine();
-        ImGui::Button("d1");
-        ImGui::SameLine();
-        if (ImGui::Button("d0")) {
-          items[gt_selectedEconomyIndex].value *= 0.9;
-        }
-      }
-
-      ImGui::End();
+      PROFILE_SCOPE("ImGui::Render");
+      ImGui::Render();
     }
     {
-      ImGui::Begin("Debug");
-      ImGui::SeparatorText("Debug");
-      ImGui::Text("dt: %.2f", 1.0f / deltaTime);
-      if (ImGui::Button("Reset Economy")) {
-        game_data::economy = Economy();
-      }
-      if (ImGui::InputText("Window Title", settings::windowTitle,
-                           IM_ARRAYSIZE(settings::windowTitle))) {
-        glfwSetWindowTitle(window, settings::windowTitle);
-      }
-      ImGui::ColorEdit4("Edit Background Color", &settings::clearColor[0]);
-      ImGui::SeparatorText("Economy Objects");
-
-      ImGui::End();
+      PROFILE_SCOPE("GL Submit");
+      int display_w, display_h;
+      glfwGetFramebufferSize(window, &display_w, &display_h);
+      glViewport(0, 0, display_w, display_h);
+      glClearColor(settings::clearColor.x, settings::clearColor.y,
+                   settings::clearColor.z, settings::clearColor.w);
+      glClear(GL_COLOR_BUFFER_BIT);
+
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      glfwSwapBuffers(window);
     }
-    ImGui::EndFrame();
-    ImGui::UpdatePlatformWindows();
-
-    ImGui::Render();
-    int display_w, display_h;
-    glfwGetFramebufferSize(window, &display_w, &display_h);
-    glViewport(0, 0, display_w, display_h);
-    glClearColor(settings::clearColor.x, settings::clearColor.y,
-                 settings::clearColor.z, settings::clearColor.w);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-    glfwSwapBuffers(window);
   }
   return cleanup();
 }
 
+// Loads the save. One that can't be read (bad magic, truncated checkpoint,
+// a record that won't decode) is moved aside, kept for inspection, and the
+// game starts over instead of refusing to start.
+void openSave() {
+  namespace fs = std::filesystem;
+  game_data::autosave =
+      std::make_unique<journal::Autosave>(game_data::saveDirectory);
+  try {
+    game_data::autosave->recover(game_data::economy);
+    return;
+  } catch (const std::exception &e) {
+    std::cerr << "Could not load the save in " << game_data::saveDirectory
+              << ": " << e.what() << std::endl;
+  }
+  game_data::autosave.reset();
+  std::string stem = std::string(game_data::saveDirectory) + ".corrupt-" +
+                     std::to_string(std::time(nullptr));
+  fs::path aside = stem;
+  for (int n = 1; fs::exists(aside); n++)
+    aside = stem + "-" + std::to_string(n);
+  std::error_code error;
+  fs::rename(game_data::saveDirectory, aside, error);
+  if (error)
+    throw std::runtime_error("Could not move the unreadable save aside: " +
+                             error.message());
+  std::cerr << "Moved it to " << aside.string() << " and started a new game"
+            << std::endl;
+  game_data::economy = Economy();
+  game_data::autosave =
+      std::make_unique<journal::Autosave>(game_data::saveDirectory);
+}
+
 void initGlfw() {
   for (auto &[k, v] : initialization::GlfwInitFlags) {
     glfwInitHint(k, v);
@@ -299,6 +231,7 @@ void initImGui() {
 }
 
 int cleanup() {
+  game_data::autosave->sync(game_data::economy);
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
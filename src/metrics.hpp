@@ -0,0 +1,278 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <charconv>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Runtime metrics in Prometheus text format. Counters and histograms write
+// to slots owned by the calling thread (a relaxed load + store, no locked
+// instruction), and a scrape sums every thread's slots. Gauges hold a single
+// value and are simply stored.
+namespace metrics {
+
+// Shortest text that round-trips, so bucket bounds print as written.
+inline std::string formatValue(double v) {
+  char buf[64];
+  auto res = std::to_chars(buf, buf + sizeof(buf), v);
+  return std::string(buf, res.ptr);
+}
+
+class Registry {
+public:
+  static constexpr size_t MAX_SLOTS = 256;
+
+  struct ThreadSlots {
+    std::array<std::atomic<double>, MAX_SLOTS> values{};
+  };
+
+  static Registry &get() {
+    static Registry registry;
+    return registry;
+  }
+
+  ThreadSlots &local() {
+    thread_local LocalSlots slots(*this);
+    return *slots.slots;
+  }
+
+  // Reserves `count` consecutive per-thread slots.
+  size_t allocate(size_t count) {
+    size_t base = nextSlot.fetch_add(count);
+    if (base + count > MAX_SLOTS)
+      throw std::length_error("metrics: out of per-thread slots");
+    return base;
+  }
+
+  double sum(size_t slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    double total = retired[slot];
+    for (auto &t : threads)
+      total += t->values[slot].load(std::memory_order_relaxed);
+    return total;
+  }
+
+  // Each metric appends its HELP/TYPE header and samples to the output.
+  void add(std::function<void(std::string &)> writer) {
+    std::lock_guard<std::mutex> lock(writersMutex);
+    writers.push_back(std::move(writer));
+  }
+
+  std::string exposition() {
+    std::string out;
+    std::lock_guard<std::mutex> lock(writersMutex);
+    for (auto &w : writers)
+      w(out);
+    return out;
+  }
+
+private:
+  // A thread's registration; when the thread exits, its counts move into
+  // `retired` and its slots are freed, so short-lived threads cost nothing
+  // once they are gone.
+  struct LocalSlots {
+    explicit LocalSlots(Registry &registry)
+        : registry(registry), slots(std::make_unique<ThreadSlots>()) {
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.threads.push_back(slots.get());
+    }
+    ~LocalSlots() {
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      for (size_t i = 0; i < MAX_SLOTS; i++)
+        registry.retired[i] += slots->values[i].load(std::memory_order_relaxed);
+      std::erase(registry.threads, slots.get());
+    }
+
+    Registry &registry;
+    std::unique_ptr<ThreadSlots> slots;
+  };
+
+  std::atomic<size_t> nextSlot{0};
+  std::mutex mutex;
+  std::vector<ThreadSlots *> threads;
+  std::array<double, MAX_SLOTS> retired{};
+  std::mutex writersMutex;
+  std::vector<std::function<void(std::string &)>> writers;
+};
+
+inline void header(std::string &out, const char *name, const char *help,
+                   const char *type) {
+  out += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name +
+         " " + type + "\n";
+}
+
+// Only ever written by the owning thread, so no read-modify-write is needed.
+inline void addLocal(size_t slot, double v) {
+  auto &a = Registry::get().local().values[slot];
+  a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+class Counter {
+public:
+  Counter(const Counter &) = delete;
+  Counter &operator=(const Counter &) = delete;
+
+  Counter(const char *name, const char *help)
+      : slot(Registry::get().allocate(1)) {
+    Registry::get().add([this, name, help](std::string &out) {
+      header(out, name, help, "counter");
+      out += std::string(name) + " " + formatValue(value()) + "\n";
+    });
+  }
+
+  void inc(double v = 1.0) { addLocal(slot, v); }
+  double value() const { return Registry::get().sum(slot); }
+
+private:
+  size_t slot;
+};
+
+class Gauge {
+public:
+  Gauge(const Gauge &) = delete;
+  Gauge &operator=(const Gauge &) = delete;
+
+  Gauge(const char *name, const char *help) {
+    Registry::get().add([this, name, help](std::string &out) {
+      header(out, name, help, "gauge");
+      out += std::string(name) + " " + formatValue(value()) + "\n";
+    });
+  }
+
+  void set(double v) { current.store(v, std::memory_order_relaxed); }
+  double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<double> current{0.0};
+};
+
+// Counter or gauge whose value is read from a callback at scrape time.
+class CallbackMetric {
+public:
+  CallbackMetric(const char *name, const char *help, const char *type,
+                 std::function<double()> read) {
+    Registry::get().add([name, help, type, read](std::string &out) {
+      header(out, name, help, type);
+      out += std::string(name) + " " + formatValue(read()) + "\n";
+    });
+  }
+};
+
+// Process-wide allocation tally. operator new can't use the per-thread slots
+// (creating them allocates), so it bumps one of a fixed set of padded shards.
+namespace alloc {
+struct alignas(64) Shard {
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> bytes{0};
+};
+constexpr size_t SHARDS = 64;
+inline std::array<Shard, SHARDS> shards;
+inline std::atomic<size_t> nextShard{0};
+
+inline void record(size_t bytes) {
+  thread_local size_t index = nextShard.fetch_add(1) % SHARDS;
+  shards[index].count.fetch_add(1, std::memory_order_relaxed);
+  shards[index].bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+inline double count() {
+  uint64_t total = 0;
+  for (auto &s : shards)
+    total += s.count.load(std::memory_order_relaxed);
+  return static_cast<double>(total);
+}
+
+inline double bytes() {
+  uint64_t total = 0;
+  for (auto &s : shards)
+    total += s.bytes.load(std::memory_order_relaxed);
+  return static_cast<double>(total);
+}
+} // namespace alloc
+
+class Histogram {
+public:
+  Histogram(const Histogram &) = delete;
+  Histogram &operator=(const Histogram &) = delete;
+
+  // bounds are the bucket upper limits, ascending; +Inf is implied.
+  Histogram(const char *name, const char *help, std::vector<double> bounds)
+      : bounds(std::move(bounds)),
+        base(Registry::get().allocate(this->bounds.size() + 3)) {
+    Registry::get().add([this, name, help](std::string &out) {
+      header(out, name, help, "histogram");
+      std::string n(name);
+      double cumulative = 0.0;
+      for (size_t i = 0; i <= this->bounds.size(); i++) {
+        cumulative += Registry::get().sum(base + i);
+        std::string le = i < this->bounds.size()
+                             ? formatValue(this->bounds[i])
+                             : std::string("+Inf");
+        out += n + "_bucket{le=\"" + le + "\"} " + formatValue(cumulative) +
+               "\n";
+      }
+      out += n + "_sum " + formatValue(Registry::get().sum(sumSlot())) + "\n";
+      out += n + "_count " + formatValue(Registry::get().sum(countSlot())) +
+             "\n";
+    });
+  }
+
+  void observe(double v) {
+    size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), v) -
+                    bounds.begin();
+    addLocal(base + bucket, 1.0);
+    addLocal(sumSlot(), v);
+    addLocal(countSlot(), 1.0);
+  }
+
+private:
+  size_t sumSlot() const { return base + bounds.size() + 1; }
+  size_t countSlot() const { return base + bounds.size() + 2; }
+
+  std::vector<double> bounds;
+  size_t base;
+};
+
+// --- Simulation Metrics ---
+namespace sim {
+inline Counter ticks("simulasi_ticks_total", "Economy::update calls");
+inline Gauge tickRate("simulasi_tick_rate", "Economy ticks per second");
+inline Histogram tickSeconds("simulasi_tick_seconds",
+                             "Wall time of one Economy::update",
+                             {1e-5, 1e-4, 5e-4, 1e-3, 5e-3, 1e-2, 5e-2, 1e-1});
+inline Counter objectsUpdated("simulasi_objects_updated_total",
+                              "EconomyObject updates");
+inline Counter formulaEvaluations("simulasi_formula_evaluations_total",
+                                  "LogicEvaluator::evaluate calls");
+inline Counter slotRolls("simulasi_slot_rolls_total", "SlotMachine rolls");
+inline Counter slotWagered("simulasi_slot_wagered_total",
+                           "Total value bid on slot machines");
+inline Counter slotPaidOut("simulasi_slot_paid_out_total",
+                           "Total value paid out by slot machines");
+inline Histogram slotMultiplier("simulasi_slot_payout_multiplier",
+                                "Payout multiplier per slot roll",
+                                {0.0, 0.5, 1.0, 2.0, 5.0, 25.0, 100.0});
+inline Counter diceRolls("simulasi_dice_rolls_total", "Dice rolls applied");
+inline Counter eventsFired("simulasi_events_fired_total",
+                           "Scheduled economy events fired");
+inline Gauge eventsPending("simulasi_events_pending",
+                           "Scheduled economy events waiting to fire");
+inline Counter agentDecisions("simulasi_agent_decisions_total",
+                              "Trader agent strategy evaluations");
+// Stay at 0 unless allocationCounter.hpp is linked in.
+inline CallbackMetric allocations("simulasi_allocations_total",
+                                  "operator new calls", "counter",
+                                  alloc::count);
+inline CallbackMetric allocatedBytes("simulasi_allocated_bytes_total",
+                                     "Bytes requested from operator new",
+                                     "counter", alloc::bytes);
+} // namespace sim
+
+} // namespace metrics
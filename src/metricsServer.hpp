@@ -0,0 +1,101 @@
+#pragma once
+#include "metrics.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdint>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace metrics {
+
+// Minimal HTTP/1.0 endpoint on 127.0.0.1 that answers every request with the
+// registry's Prometheus exposition. Runs on its own thread; the simulation
+// never waits on it.
+class Server {
+public:
+  ~Server() { stop(); }
+
+  // Returns false if the port can't be bound.
+  bool start(uint16_t port) {
+    stop();
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+      return false;
+    int yes = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        ::listen(fd, 8) < 0) {
+      ::close(fd);
+      return false;
+    }
+
+    listenFd = fd;
+    boundPort = port;
+    running = true;
+    worker = std::thread([this] { serve(); });
+    return true;
+  }
+
+  void stop() {
+    running = false;
+    if (worker.joinable())
+      worker.join();
+    if (listenFd >= 0) {
+      ::close(listenFd);
+      listenFd = -1;
+    }
+  }
+
+  bool isRunning() const { return running; }
+  uint16_t port() const { return boundPort; }
+
+private:
+  void serve() {
+    while (running) {
+      pollfd pfd{listenFd, POLLIN, 0};
+      if (::poll(&pfd, 1, 200) <= 0)
+        continue;
+      int client = ::accept(listenFd, nullptr, nullptr);
+      if (client < 0)
+        continue;
+
+      // The request itself is irrelevant; drain what has arrived.
+      char request[1024];
+      pollfd cfd{client, POLLIN, 0};
+      if (::poll(&cfd, 1, 200) > 0)
+        (void)::recv(client, request, sizeof(request), 0);
+
+      std::string body = Registry::get().exposition();
+      std::string response =
+          "HTTP/1.0 200 OK\r\n"
+          "Content-Type: text/plain; version=0.0.4\r\n"
+          "Content-Length: " +
+          std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+      size_t sent = 0;
+      while (sent < response.size()) {
+        ssize_t n = ::send(client, response.data() + sent,
+                           response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+          break;
+        sent += static_cast<size_t>(n);
+      }
+      ::close(client);
+    }
+  }
+
+  std::atomic<bool> running{false};
+  int listenFd = -1;
+  uint16_t boundPort = 0;
+  std::thread worker;
+};
+
+} // namespace metrics
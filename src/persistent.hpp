@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Copy-on-write containers with structural sharing. A Column is a table of
+// fixed-size chunks behind shared pointers, so copying one only bumps a
+// reference count. A write clones the table and the touched chunk if either
+// is still shared, so a copy costs memory only for the chunks that change
+// after it was taken.
+namespace persistent {
+
+namespace detail {
+inline std::atomic<int64_t> chunkBytes{0};
+} // namespace detail
+
+// Bytes held by every live chunk of every Column, shared chunks counted
+// once.
+inline size_t liveBytes() {
+  return static_cast<size_t>(
+      detail::chunkBytes.load(std::memory_order_relaxed));
+}
+
+template <typename T, size_t ChunkBits = 10> class Column {
+public:
+  static constexpr size_t CHUNK = size_t{1} << ChunkBits;
+  static constexpr size_t MASK = CHUNK - 1;
+
+  Column() = default;
+  explicit Column(size_t n, const T &fill = T()) { resize(n, fill); }
+
+  // Copies share the table; both sides note it so the next write knows to
+  // check whether the table is still shared.
+  Column(const Column &other)
+      : table(other.table), slots(other.slots), length(other.length),
+        shared(true) {
+    other.shared = true;
+  }
+  Column &operator=(const Column &other) {
+    if (this != &other) {
+      table = other.table;
+      slots = other.slots;
+      length = other.length;
+      shared = true;
+      other.shared = true;
+    }
+    return *this;
+  }
+  Column(Column &&other) noexcept { *this = std::move(other); }
+  Column &operator=(Column &&other) noexcept {
+    table = std::move(other.table);
+    slots = std::exchange(other.slots, nullptr);
+    length = std::exchange(other.length, 0);
+    shared = other.shared;
+    return *this;
+  }
+
+  size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+  size_t chunkCount() const { return table ? table->slots.size() : 0; }
+
+  const T &operator[](size_t i) const {
+    return slots[i >> ChunkBits].data[i & MASK];
+  }
+
+  // Writable element. The reference stays valid until this column is
+  // copied.
+  T &mut(size_t i) { return ownChunk(i >> ChunkBits)[i & MASK]; }
+
+  // Chunk c's elements; the last chunk is only valid up to size().
+  const T *chunk(size_t c) const { return slots[c].data; }
+  T *mutableChunk(size_t c) { return ownChunk(c); }
+
+  // Makes the chunk table private. Afterwards, mutableChunk may be called
+  // from several threads at once as long as each thread uses its own chunks.
+  void detach() { ownTable(); }
+
+  void resize(size_t n, const T &fill = T()) {
+    ownTable();
+    size_t filled = std::min(n, table->slots.size() * CHUNK);
+    for (size_t i = length; i < filled; i++)
+      mut(i) = fill;
+    size_t chunks = (n + MASK) >> ChunkBits;
+    if (chunks < table->slots.size()) {
+      table->slots.resize(chunks);
+      table->chunks.resize(chunks);
+    }
+    while (table->slots.size() < chunks)
+      table->add()->data.fill(fill);
+    slots = table->slots.data();
+    length = n;
+  }
+
+  void push_back(const T &v) {
+    if ((length & MASK) == 0) {
+      ownTable();
+      table->add();
+      slots = table->slots.data();
+    }
+    mut(length++) = v;
+  }
+
+  void clear() {
+    table.reset();
+    slots = nullptr;
+    length = 0;
+  }
+
+private:
+  struct Chunk {
+    std::array<T, CHUNK> data;
+
+    Chunk() { count(1); }
+    Chunk(const Chunk &other) : data(other.data) { count(1); }
+    ~Chunk() { count(-1); }
+
+    static void count(int64_t sign) {
+      detail::chunkBytes.fetch_add(sign * static_cast<int64_t>(sizeof(Chunk)),
+                                   std::memory_order_relaxed);
+    }
+  };
+
+  // Raw pointer and ownership flag per chunk, kept apart from the
+  // shared_ptrs so element access never touches a control block. `owned`
+  // means no other table holds the chunk, so it can be written in place.
+  struct Slot {
+    T *data;
+    bool owned;
+  };
+
+  struct Table {
+    std::vector<Slot> slots;
+    std::vector<std::shared_ptr<Chunk>> chunks;
+
+    Table() = default;
+    // A cloned table shares every chunk with its source, so neither side
+    // owns any of them any more.
+    Table(Table &source) : slots(source.slots), chunks(source.chunks) {
+      for (auto &s : source.slots)
+        s.owned = false;
+      for (auto &s : slots)
+        s.owned = false;
+    }
+
+    Chunk *add() {
+      chunks.push_back(std::make_shared<Chunk>());
+      slots.push_back({chunks.back()->data.data(), true});
+      return chunks.back().get();
+    }
+  };
+
+  void ownTable() {
+    if (!table)
+      table = std::make_shared<Table>();
+    else if (table.use_count() != 1)
+      table = std::make_shared<Table>(*table);
+    slots = table->slots.data();
+    shared = false;
+  }
+
+  T *ownChunk(size_t c) {
+    if (shared)
+      ownTable();
+    Slot &slot = slots[c];
+    if (!slot.owned) {
+      table->chunks[c] = std::make_shared<Chunk>(*table->chunks[c]);
+      slot = {table->chunks[c]->data.data(), true};
+    }
+    return slot.data;
+  }
+
+  std::shared_ptr<Table> table;
+  // table->slots.data(), cached to save a load per access.
+  Slot *slots = nullptr;
+  size_t length = 0;
+  // Set on both sides of a copy and cleared once this side owns its table;
+  // saves a reference count load on every write.
+  mutable bool shared = false;
+};
+
+// Fixed-length ring over a Column, indexed oldest first. A push rewrites a
+// single element, so between two copies only the chunks the write head
+// passed over are duplicated. Chunks are small (16 samples by default)
+// since the first push after every snapshot clones one.
+template <typename T, size_t ChunkBits = 4> class Ring {
+public:
+  Ring() = default;
+  Ring(size_t n, const T &fill) : data(n, fill) {}
+
+  size_t size() const { return data.size(); }
+  bool empty() const { return data.empty(); }
+
+  const T &operator[](size_t i) const {
+    size_t at = head + i;
+    return data[at >= data.size() ? at - data.size() : at];
+  }
+  const T &back() const { return (*this)[data.size() - 1]; }
+
+  // Overwrites the oldest sample.
+  void push(const T &v) {
+    if (data.empty())
+      return;
+    data.mut(head) = v;
+    if (++head == data.size())
+      head = 0;
+  }
+
+  // Calls f(const T *, count) over the storage in chunk order (not oldest
+  // first), for order-independent scans like min/max.
+  template <typename F> void forEachChunk(F &&f) const {
+    for (size_t c = 0; c < data.chunkCount(); c++) {
+      size_t begin = c << ChunkBits;
+      f(data.chunk(c), std::min(data.size() - begin, size_t{1} << ChunkBits));
+    }
+  }
+
+private:
+  Column<T, ChunkBits> data;
+  size_t head = 0;
+};
+
+} // namespace persistent
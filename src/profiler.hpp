@@ -0,0 +1,255 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped-timer profiler. PROFILE_SCOPE("name") records a nested zone into a
+// per-thread ring buffer; building with -DSIMULASI_DISABLE_PROFILER turns
+// every macro into nothing. Zone names must be string literals (or otherwise
+// outlive the profiler), since only the pointer is stored.
+namespace profiler {
+
+inline uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Zone {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+  uint32_t depth;
+  uint32_t thread;
+};
+
+// Single-producer ring. The owning thread writes and publishes with a
+// release store of head; readers copy a range and then drop whatever the
+// producer may have overwritten meanwhile, so neither side ever locks.
+class ThreadBuffer {
+public:
+  static constexpr size_t CAPACITY = 1 << 14;
+
+  explicit ThreadBuffer(uint32_t id) : thread(id) {}
+
+  void push(const Zone &zone) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    zones[h & (CAPACITY - 1)] = zone;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  // Appends the intact zones in [from, head) to out and returns the new
+  // cursor.
+  uint64_t read(uint64_t from, std::vector<Zone> &out) const {
+    uint64_t h = head.load(std::memory_order_acquire);
+    if (h - from > CAPACITY)
+      from = h - CAPACITY;
+    size_t begin = out.size();
+    for (uint64_t i = from; i < h; ++i)
+      out.push_back(zones[i & (CAPACITY - 1)]);
+
+    // The fence orders the copies above before the second head load. The
+    // producer may be halfway through slot `after`, which overwrites zone
+    // after - CAPACITY, so that one counts as lost too.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = head.load(std::memory_order_relaxed);
+    if (after - from >= CAPACITY) {
+      size_t lost =
+          std::min<uint64_t>(after - from - CAPACITY + 1, h - from);
+      out.erase(out.begin() + begin, out.begin() + begin + lost);
+    }
+    return h;
+  }
+
+  const uint32_t thread;
+  uint32_t depth = 0;
+
+private:
+  std::array<Zone, CAPACITY> zones;
+  std::atomic<uint64_t> head{0};
+};
+
+class Registry {
+public:
+  static Registry &get() {
+    static Registry registry;
+    return registry;
+  }
+
+  ThreadBuffer &local() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = add();
+    return *buffer;
+  }
+
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return threads;
+  }
+
+private:
+  // Only taken once per thread, on its first zone.
+  std::shared_ptr<ThreadBuffer> add() {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(
+        std::make_shared<ThreadBuffer>(static_cast<uint32_t>(threads.size())));
+    return threads.back();
+  }
+
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> threads;
+};
+
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const char *name)
+      : buffer(Registry::get().local()), name(name), depth(buffer.depth++),
+        start(now()) {}
+
+  ~ScopedTimer() {
+    buffer.push({name, start, now(), depth, buffer.thread});
+    buffer.depth--;
+  }
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+  ThreadBuffer &buffer;
+  const char *name;
+  uint32_t depth;
+  uint64_t start;
+};
+
+// Per-frame collector, driven from the main thread by frameMark(). Keeps the
+// last completed frame for the timeline and a rolling window of per-zone
+// totals for percentiles.
+class FrameProfiler {
+public:
+  static constexpr size_t HISTORY = 240;
+
+  struct Stats {
+    std::array<double, HISTORY> samples{}; // milliseconds per frame
+    size_t count = 0;
+    double last = 0.0;
+
+    double percentile(double p) const {
+      size_t n = std::min(count, HISTORY);
+      if (n == 0)
+        return 0.0;
+      std::vector<double> sorted(samples.begin(), samples.begin() + n);
+      size_t k = std::min(n - 1, static_cast<size_t>(p * (n - 1) + 0.5));
+      std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+      return sorted[k];
+    }
+  };
+
+  static FrameProfiler &get() {
+    static FrameProfiler instance;
+    return instance;
+  }
+
+  void frameMark() {
+    uint64_t t = now();
+    if (frameStart != 0 && !paused) {
+      collect(frameStart, t);
+    }
+    frameStart = t;
+  }
+
+  const std::vector<Zone> &lastFrame() const { return frameZones; }
+  uint64_t lastFrameStart() const { return lastStart; }
+  uint64_t lastFrameEnd() const { return lastEnd; }
+  const std::map<const char *, Stats> &stats() const { return zoneStats; }
+
+  bool paused = false;
+
+private:
+  void collect(uint64_t start, uint64_t end) {
+    auto buffers = Registry::get().buffers();
+    cursors.resize(buffers.size(), 0);
+
+    frameZones.clear();
+    for (size_t i = 0; i < buffers.size(); ++i) {
+      cursors[i] = buffers[i]->read(cursors[i], frameZones);
+    }
+    lastStart = start;
+    lastEnd = end;
+
+    std::map<const char *, double> totals;
+    for (const Zone &z : frameZones) {
+      totals[z.name] += (z.end - z.start) / 1e6;
+    }
+    for (auto &[name, stats] : zoneStats) {
+      if (!totals.contains(name))
+        totals[name] = 0.0;
+    }
+    for (auto &[name, ms] : totals) {
+      Stats &s = zoneStats[name];
+      s.samples[s.count++ % HISTORY] = ms;
+      s.last = ms;
+    }
+  }
+
+  uint64_t frameStart = 0;
+  uint64_t lastStart = 0;
+  uint64_t lastEnd = 0;
+  std::vector<uint64_t> cursors;
+  std::vector<Zone> frameZones;
+  std::map<const char *, Stats> zoneStats;
+};
+
+inline void frameMark() { FrameProfiler::get().frameMark(); }
+
+// Writes every zone still held in the thread buffers as Chrome trace JSON
+// (chrome://tracing, Perfetto). Returns false if the file can't be opened.
+inline bool exportChromeTrace(const std::string &path) {
+  std::vector<Zone> zones;
+  for (auto &buffer : Registry::get().buffers()) {
+    buffer->read(0, zones);
+  }
+  std::ofstream out(path);
+  if (!out)
+    return false;
+
+  uint64_t origin = UINT64_MAX;
+  for (const Zone &z : zones)
+    origin = std::min(origin, z.start);
+
+  // Microseconds with nanosecond decimals; the default 6 significant digits
+  // would go scientific after a second of trace.
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  for (size_t i = 0; i < zones.size(); ++i) {
+    const Zone &z = zones[i];
+    out << (i ? ",\n" : "\n") << "{\"name\":\"" << z.name
+        << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << z.thread
+        << ",\"ts\":" << (z.start - origin) / 1e3
+        << ",\"dur\":" << (z.end - z.start) / 1e3 << "}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return static_cast<bool>(out);
+}
+} // namespace profiler
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SIMULASI_DISABLE_PROFILER
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_FRAME()
+#else
+#define PROFILE_SCOPE(name)                                                    \
+  ::profiler::ScopedTimer PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_FRAME() ::profiler::frameMark()
+#endif
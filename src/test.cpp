@@ -1,8 +1,10 @@
 #include "functionlang.hpp"
 
 #include <cstring>
+#include <memory>
 #include <format>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -46,6 +48,13 @@ Binary Operators:\n\
 - ~ : Round (round V0 by V1)\n\
 Ternary Operators:\n\
 - ? : Ternary Operator\n\
+History Window Operators ([n] is a literal window length):\n\
+- A[n] : Mean of the last n samples\n\
+- U[n] : Sum\n\
+- N[n] : Min\n\
+- X[n] : Max\n\
+- D[n] : Variance\n\
+- E[n] : Exponential moving average (alpha = 2/(n+1))\n\
 Usage:\n\
 - [op][x],[y],[z] for ternary operators\n\
 - [op][x],[y]     for binary operators\n\
@@ -60,6 +69,7 @@ s16           | 4           | sqrt(16)\n\
 L^2,3         | 3           | log_2(2^3)\n\
 G10,100       | 2           | log_10(100)\n\
 g100          | 2           | log10(100)\n\
+A3            | 2           | mean of history 1,2,3 (:p 1 2 3)\n\
 ",
                                             functionlang::VERSION);
 
@@ -70,8 +80,23 @@ int main() {
   std::vector<double> values;
   values.resize(256, 0.0);
 
+  // Samples the window operators (A, U, N, X, D, E) aggregate over.
+  std::vector<double> history;
+  // Compiles against a window set primed with the REPL history.
+  auto compile = [&history](const char *&ptr,
+                            functionlang::ExprProfile *profile = nullptr) {
+    auto windows = std::make_shared<functionlang::WindowSet<>>();
+    auto formula = functionlang::parseExpression(ptr, windows.get(), profile);
+    for (double sample : history)
+      windows->push(sample);
+    return [windows, formula](functionlang::ExprFuncRet<> args) {
+      return formula(args, windows.get());
+    };
+  };
+
   std::cout << ":q to exit | :h for help | :s V[n] [expr] | V[0-255] to index "
-               "value store"
+               "value store | :p [values...] to push history | :c to clear "
+               "history | :t [runs] [expr] to profile"
             << std::endl;
 
   while (true) {
@@ -83,6 +108,52 @@ int main() {
       std::cout << help_string << std::endl;
       continue;
     }
+    if (input_buffer == ":c") {
+      history.clear();
+      continue;
+    }
+    if (input_buffer.starts_with(":p")) {
+      std::istringstream samples(input_buffer.substr(2));
+      double sample;
+      while (samples >> sample)
+        history.push_back(sample);
+      std::cout << "history: " << history.size() << " samples" << std::endl;
+      continue;
+    }
+    if (input_buffer.starts_with(":t")) {
+      std::istringstream command(input_buffer.substr(2));
+      size_t runs = 0;
+      std::string expr;
+      if (!(command >> runs) || !std::getline(command >> std::ws, expr)) {
+        std::cerr << Color::Red << "Usage: :t [runs] [expr]" << Color::Reset
+                  << std::endl;
+        continue;
+      }
+      functionlang::ExprProfile profile;
+      const char *cs = expr.c_str();
+      auto formula = compile(cs, &profile);
+      double result = 0.0;
+      for (size_t i = 0; i < runs; i++)
+        result = formula(values);
+      std::cout << "= " << result << "\n"
+                << std::format("{:>10} {:>10} {:>10} {:>8} {:>7}  {}\n",
+                               "calls", "ns/call", "self ns", "nan/inf",
+                               "guards", "node");
+      const auto &nodes = profile.nodes();
+      for (size_t i = 0; i < nodes.size(); i++) {
+        const auto &n = nodes[i];
+        double calls = static_cast<double>(std::max<uint64_t>(n.calls, 1));
+        bool flagged = n.guardHits || n.nonFinite;
+        std::cout << std::format(
+            "{:>10} {:>10.1f} {:>10.1f} {:>8} {:>7}  {}{}{} ({}){}\n", n.calls,
+            n.nanos / calls, profile.selfNanos(i) / calls, n.nonFinite,
+            n.guardHits, std::string(n.depth * 2, ' '),
+            flagged ? Color::Yellow : "", n.source,
+            functionlang::ExprProfile::opName(n.op),
+            flagged ? Color::Reset : "");
+      }
+      continue;
+    }
     if (input_buffer.starts_with(":s")) {
       try {
         size_t v_pos = input_buffer.find('V');
@@ -92,7 +163,7 @@ int main() {
               std::stoi(input_buffer.substr(v_pos + 1, space_pos - v_pos - 1));
           std::string expr_part = input_buffer.substr(space_pos + 1);
           auto cs = expr_part.c_str();
-          double result = functionlang::parseExpression(cs)({10, 5});
+          double result = compile(cs)({10, 5});
           if (index >= 0 && index < (int)values.size()) {
             values[index] = result;
             std::cout << "V" << index << " = " << result << std::endl;
@@ -109,7 +180,7 @@ int main() {
     }
     pt = input_buffer.c_str();
 
-    std::cout << functionlang::parseExpression(pt)(values) << std::endl;
+    std::cout << compile(pt)(values) << std::endl;
   }
   return 0;
 }
@@ -1,41 +1,186 @@
 #pragma once
 #include "functionlang.hpp"
+#include "metrics.hpp"
 #include <algorithm>
 #include <cfloat>
 #include <climits>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <random>
+#include <span>
 #include <sstream>
 
 namespace util {
 
 namespace rand {
+// splitmix64's finalizer: a bijective scramble of one word. Hashing (seed,
+// tick, index) through it gives per-item draws that don't depend on which
+// thread, or in what order, they are taken.
+inline uint64_t mix64(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// xoshiro256** (Blackman & Vigna). 32 bytes of state, a handful of
+// instructions per draw, and jump functions that split the period into
+// non-overlapping streams for parallel workers. Satisfies
+// UniformRandomBitGenerator, so it also drives the <random> distributions.
+class Xoshiro256 {
+public:
+  using result_type = uint64_t;
+
+  explicit Xoshiro256(uint64_t seed = 0x9E3779B97F4A7C15ull) { reseed(seed); }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  void reseed(uint64_t seed) {
+    // Expand the seed with splitmix64 so similar seeds give unrelated states.
+    for (auto &word : s) {
+      seed += 0x9E3779B97F4A7C15ull;
+      word = mix64(seed);
+    }
+  }
+
+  result_type operator()() {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  // Advances the state by 2^128 draws.
+  void jump() {
+    static constexpr uint64_t JUMP[] = {0x180EC6D33CFD0ABAull,
+                                        0xD5A61266F0C9392Cull,
+                                        0xA9582618E03FC9AAull,
+                                        0x39ABDC4529B1661Cull};
+    applyJump(JUMP);
+  }
+
+  // Advances the state by 2^192 draws.
+  void long_jump() {
+    static constexpr uint64_t LONG_JUMP[] = {0x76E15D3EFEFDCBBFull,
+                                             0xC5004E441C522FB3ull,
+                                             0x77710069854EE241ull,
+                                             0x39109BB02ACBE635ull};
+    applyJump(LONG_JUMP);
+  }
+
+  // Returns a generator for the current 2^128-long block and moves this one
+  // past it, so the two never produce overlapping sequences.
+  Xoshiro256 split() {
+    Xoshiro256 child = *this;
+    jump();
+    return child;
+  }
+
+  // Unbiased integer in [0, range) (Lemire's multiply-shift rejection).
+  uint64_t bounded(uint64_t range) {
+    __uint128_t m = static_cast<__uint128_t>((*this)()) * range;
+    uint64_t low = static_cast<uint64_t>(m);
+    if (low < range) {
+      const uint64_t threshold = -range % range;
+      while (low < threshold) {
+        m = static_cast<__uint128_t>((*this)()) * range;
+        low = static_cast<uint64_t>(m);
+      }
+    }
+    return static_cast<uint64_t>(m >> 64);
+  }
+
+  // Uniform in [0, 1) built straight from the high mantissa bits.
+  float next_float() { return ((*this)() >> 40) * 0x1.0p-24f; }
+  double next_double() { return ((*this)() >> 11) * 0x1.0p-53; }
+
+private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  void applyJump(const uint64_t (&poly)[4]) {
+    uint64_t t[4] = {0, 0, 0, 0};
+    for (uint64_t word : poly) {
+      for (int b = 0; b < 64; ++b) {
+        if (word & (uint64_t{1} << b)) {
+          for (int i = 0; i < 4; ++i)
+            t[i] ^= s[i];
+        }
+        (*this)();
+      }
+    }
+    for (int i = 0; i < 4; ++i)
+      s[i] = t[i];
+  }
+
+  uint64_t s[4];
+};
+
 class Random {
-  static std::mt19937 &get_engine() {
-    thread_local std::mt19937 engine(std::random_device{}());
+public:
+  using Engine = Xoshiro256;
+
+  // Per-thread engine. Each thread starts from a random_device seed; workers
+  // that need reproducible, non-overlapping streams install one from split().
+  static Engine &get_engine() {
+    thread_local Engine engine(
+        (static_cast<uint64_t>(std::random_device{}()) << 32) ^
+        std::random_device{}());
     return engine;
   }
 
-public:
+  static void seed(uint64_t seed) { get_engine().reseed(seed); }
+  static void set_engine(const Engine &engine) { get_engine() = engine; }
+  static Engine split() { return get_engine().split(); }
+
   static int get_int(int min = INT_MIN, int max = INT_MAX) {
-    std::uniform_int_distribution<int> dist(min, max);
-    return dist(get_engine());
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+    return static_cast<int>(min + static_cast<int64_t>(
+                                      get_engine().bounded(range)));
   }
 
   static unsigned int get_unsigned_int(unsigned int min = 0,
                                        unsigned int max = UINT_MAX) {
-    std::uniform_int_distribution<unsigned int> dist(min, max);
-    return dist(get_engine());
+    uint64_t range = static_cast<uint64_t>(max) - min + 1;
+    return min + static_cast<unsigned int>(get_engine().bounded(range));
   }
 
   static float get_float(float min = 0.0f, float max = 1.0f) {
-    std::uniform_real_distribution<float> dist(min, max);
-    return dist(get_engine());
+    return min + get_engine().next_float() * (max - min);
   }
 
   static double get_double(double min = 0.0, double max = 1.0) {
-    std::uniform_real_distribution<double> dist(min, max);
-    return dist(get_engine());
+    return min + get_engine().next_double() * (max - min);
+  }
+
+  // --- Bulk Fill ---
+  static void fill_int(std::span<int> out, int min = INT_MIN,
+                       int max = INT_MAX) {
+    Engine &engine = get_engine();
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+    for (auto &v : out)
+      v = static_cast<int>(min + static_cast<int64_t>(engine.bounded(range)));
+  }
+
+  static void fill_float(std::span<float> out, float min = 0.0f,
+                         float max = 1.0f) {
+    Engine &engine = get_engine();
+    const float scale = max - min;
+    for (auto &v : out)
+      v = min + engine.next_float() * scale;
+  }
+
+  static void fill_double(std::span<double> out, double min = 0.0,
+                          double max = 1.0) {
+    Engine &engine = get_engine();
+    const double scale = max - min;
+    for (auto &v : out)
+      v = min + engine.next_double() * scale;
   }
 };
 }; // namespace rand
@@ -179,27 +324,95 @@ template <typename T> void reverseVector(std::vector<T> &vec) {
   }
 }
 
-class LogicEvaluator {
+// A compiled functionlang formula and its source. Number is the type it
+// evaluates in: double, or BigNumber for economy values.
+//
+// The parsed formula is immutable and shared by every copy; a copy only
+// duplicates the window accumulators it feeds, so copying an object whose
+// formulas read no history costs one reference count per formula.
+template <typename Number = double> class LogicEvaluator {
 private:
-  std::function<double(const std::vector<double> &)> formula;
-  std::string rawSource;
+  struct Compiled {
+    std::string source;
+    functionlang::ExprFunc<Number> formula;
+    // The windows the formula reads, still empty; each evaluator starts
+    // its own set from this one.
+    functionlang::WindowSet<Number> layout;
+    // Only while profiling; the formula is compiled with timing wrappers
+    // then. The one part that changes after compiling: copies share its
+    // counters.
+    std::unique_ptr<functionlang::ExprProfile> profile;
+  };
+
+  static std::shared_ptr<const Compiled> compile(const std::string &source,
+                                                 bool profiled) {
+    auto c = std::make_shared<Compiled>();
+    c->source = source;
+    if (profiled)
+      c->profile = std::make_unique<functionlang::ExprProfile>();
+    const char *ptr = c->source.c_str();
+    c->formula = functionlang::parseExpression<Number>(ptr, &c->layout,
+                                                       c->profile.get());
+    return c;
+  }
+
+  std::shared_ptr<const Compiled> compiled;
+  // Accumulators behind the windowed history operators.
+  functionlang::WindowSet<Number> windows;
 
 public:
-  LogicEvaluator(const std::string &source = "0") : rawSource(source) {
-    const char *ptr = rawSource.c_str();
-    formula = functionlang::parseExpression(ptr);
+  LogicEvaluator(const std::string &source = "0")
+      : compiled(compile(source, false)), windows(compiled->layout) {}
+
+  Number evaluate(const std::vector<Number> &args) const {
+    metrics::sim::formulaEvaluations.inc();
+    return compiled->formula(args, &windows);
+  }
+
+  // Feeds one history sample to the windowed operators (no-op without any).
+  void observe(Number sample) {
+    if (!windows.empty())
+      windows.push(sample);
   }
 
-  float evaluate(const std::vector<double> &args) const {
-    return formula(args);
+  // Primes the windowed operators with an existing history, oldest first.
+  // Takes anything indexable with size().
+  template <typename History> void observeHistory(const History &history) {
+    if (windows.empty())
+      return;
+    for (size_t i = 0; i < history.size(); i++)
+      windows.push(history[i]);
   }
 
-  std::string getSource() const { return rawSource; }
+  bool usesHistory() const { return !windows.empty(); }
+  const functionlang::WindowSet<Number> &getWindows() const {
+    return windows;
+  }
+  functionlang::WindowSet<Number> &getWindows() { return windows; }
+  // What a copy duplicates; the compiled formula is shared.
+  size_t heapBytes() const { return windows.heapBytes(); }
+
+  const std::string &getSource() const { return compiled->source; }
 
   void updateFormula(const std::string &newSource) {
-    rawSource = newSource;
-    const char *ptr = rawSource.c_str();
-    formula = functionlang::parseExpression(ptr);
+    compiled = compile(newSource, isProfiling());
+    windows = compiled->layout;
+  }
+
+  // Recompiles with or without per-node instrumentation; window state
+  // carries over.
+  void setProfiling(bool on) {
+    if (on != isProfiling())
+      compiled = compile(compiled->source, on);
+  }
+  bool isProfiling() const { return compiled->profile != nullptr; }
+  // Null unless profiling.
+  const functionlang::ExprProfile *getProfile() const {
+    return compiled->profile.get();
+  }
+  void resetProfile() {
+    if (compiled->profile)
+      compiled->profile->reset();
   }
 };
 